@@ -0,0 +1,64 @@
+#include "ActorStore.hpp"
+
+ActorStore::Slot ActorStore::Add(uint32_t actor_id, glm::ivec2 pos, const ActorStats& actor_stats) {
+	Slot slot = id.size();
+	id.push_back(actor_id);
+	position.push_back(pos);
+	stats.push_back(actor_stats);
+	items.emplace_back();
+	next_action.push_back(0);
+	if(actor_id >= m_slots.size()) {
+		m_slots.resize(actor_id + 1, invalid);
+	}
+	m_slots[actor_id] = slot;
+	return slot;
+}
+
+void ActorStore::Remove(Slot slot) {
+	Slot last = id.size() - 1;
+	m_slots[id[slot]] = invalid;
+	if(slot != last) {
+		id[slot] 			= id[last];
+		position[slot] 		= position[last];
+		stats[slot] 		= stats[last];
+		items[slot] 		= std::move(items[last]);
+		next_action[slot] 	= next_action[last];
+		m_slots[id[slot]] 	= slot;
+	}
+	id.pop_back();
+	position.pop_back();
+	stats.pop_back();
+	items.pop_back();
+	next_action.pop_back();
+}
+
+ActorStore::Slot ActorStore::Find(uint32_t actor_id) const {
+	return actor_id < m_slots.size() ? m_slots[actor_id] : invalid;
+}
+
+size_t ActorStore::Size() const {
+	return id.size();
+}
+
+void ActorStore::Clear() {
+	id.clear();
+	position.clear();
+	stats.clear();
+	items.clear();
+	next_action.clear();
+	m_slots.clear();
+}
+
+size_t ActorStore::GetMemoryUsage() const {
+	return id.capacity() * sizeof(uint32_t) + position.capacity() * sizeof(glm::ivec2) +
+		stats.capacity() * sizeof(ActorStats) + items.capacity() * sizeof(Inventory) +
+		next_action.capacity() * sizeof(uint32_t) + m_slots.capacity() * sizeof(Slot);
+}
+
+void ActorStore::ShrinkToFit() {
+	id.shrink_to_fit();
+	position.shrink_to_fit();
+	stats.shrink_to_fit();
+	items.shrink_to_fit();
+	next_action.shrink_to_fit();
+}
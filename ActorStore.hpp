@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Inventory.hpp"
+
+struct ActorStats {
+	static constexpr int normal_speed = 100;
+	int hp;
+	int armor;
+	int damage;
+	int speed; // actions per normal_speed actions of normal actor
+};
+
+// All actors (player included) as structure of arrays. Slots are dense, removing an actor
+// moves the last one into its slot, so slots are only valid until next removal.
+// Ids are stable and map to current slot.
+class ActorStore {
+public:
+	using Slot = uint32_t;
+	static constexpr Slot invalid = UINT32_MAX;
+	
+	Slot 	Add(uint32_t id, glm::ivec2 position, const ActorStats& stats);
+	void 	Remove(Slot slot);
+	Slot 	Find(uint32_t id) const;
+	size_t 	Size() const;
+	void 	Clear();
+	// bytes of arrays, without heap storage of big inventories
+	size_t 	GetMemoryUsage() const;
+	void 	ShrinkToFit();
+	
+	// components, indexed by slot
+	std::vector<uint32_t> 			id;
+	std::vector<glm::ivec2> 		position;
+	std::vector<ActorStats> 		stats;
+	std::vector<Inventory> 			items;
+	std::vector<uint32_t> 			next_action; // scheduler time of next action
+
+private:
+	std::vector<Slot> m_slots; // indexed by id
+};
@@ -0,0 +1,59 @@
+#include "AllocTracker.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations(0);
+std::atomic<uint64_t> g_frees(0);
+std::atomic<uint64_t> g_bytes(0);
+
+void* allocate(size_t size) {
+	AllocTracker::Allocated(size);
+	if(void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* allocateAligned(size_t size, std::align_val_t align) {
+	AllocTracker::Allocated(size);
+	size_t a = static_cast<size_t>(align);
+	// aligned_alloc wants size to be multiple of alignment
+	if(void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+	throw std::bad_alloc();
+}
+
+void release(void* p) {
+	if(!p) return;
+	AllocTracker::Freed();
+	std::free(p);
+}
+
+}
+
+void AllocTracker::Allocated(size_t bytes) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	g_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocTracker::Freed() {
+	g_frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+AllocTracker::Counts AllocTracker::TotalCounts() {
+	return {g_allocations.load(std::memory_order_relaxed), g_frees.load(std::memory_order_relaxed), g_bytes.load(std::memory_order_relaxed)};
+}
+
+// replacements of global allocation functions, other forms call these
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t align) { return allocateAligned(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return allocateAligned(size, align); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { release(p); }
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Counts heap allocations made through global operator new by all threads.
+// Replaces global new and delete, so it is linked only into headless.
+class AllocTracker {
+public:
+	struct Counts {
+		uint64_t allocations;
+		uint64_t frees;
+		uint64_t bytes; // requested by allocations
+	};
+
+	// all threads since start
+	static Counts 	TotalCounts();
+	static void 	Allocated(size_t bytes);
+	static void 	Freed();
+};
@@ -0,0 +1,493 @@
+#include "Model.hpp"
+#include "View.hpp"
+#include "Controller.hpp"
+#include "DistanceMap.hpp"
+#include "PathFinder.hpp"
+#include "FieldOfView.hpp"
+#include "Scheduler.hpp"
+#include "ActorStore.hpp"
+#include "Trace.hpp"
+#include "libs/json.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+// Micro and macro benchmarks of engine parts, results are printed as JSON.
+// Every benchmark repeats its operation, doubling the count until it ran for min_time.
+// usage: bench [--filter substring] [--min-time seconds] [--out file]
+//        bench --compare base.json new.json   (table of two result files, nothing is run)
+
+using nlohmann::json;
+using bench_clock = std::chrono::steady_clock;
+
+static std::string g_filter;
+static double g_min_time = 0.3;
+static json g_results = json::array();
+
+// op(n) performs n operations, extra is filled by op with values worth reporting.
+// Returns nanoseconds per operation, 0 when filtered out.
+template<class Op>
+static double bench(const std::string& name, json params, Op op) {
+	if(!g_filter.empty() && name.find(g_filter) == std::string::npos) return 0;
+	json extra = json::object();
+	uint64_t n = 1;
+	double seconds = 0;
+	for(;;) {
+		auto start = bench_clock::now();
+		op(n, extra);
+		seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+		if(seconds >= g_min_time || n >= (1ull << 32)) break;
+		n = seconds > 0 ? std::max<uint64_t>(n * 2, uint64_t(n * g_min_time / seconds * 1.2)) : n * 16;
+	}
+	json result = {{"name", name}, {"params", params}, {"iterations", n}, {"ns_per_op", seconds * 1e9 / n}};
+	if(!extra.empty()) {
+		result["extra"] = extra;
+	}
+	fprintf(stderr, "%-28s %-36s %12.1f ns/op\n", name.c_str(), params.dump().c_str(), seconds * 1e9 / n);
+	g_results.push_back(result);
+	return seconds * 1e9 / n;
+}
+
+// config with some values replaced, model loads config only from file
+static std::string configWith(json changes) {
+	json j;
+	std::ifstream("config/config.json") >> j;
+	for(auto &it : changes.items()) {
+		j["config"][it.key()] = it.value();
+	}
+	std::string path = (std::filesystem::temp_directory_path() / "bench_config.json").string();
+	std::ofstream(path) << j;
+	return path;
+}
+
+// new game with square of world_chunks x world_chunks chunks generated around player
+static void makeWorld(Model& model, Controller& controller, int world_chunks) {
+	model.SetCanvasSize({80, 24});
+	controller.StartNewGame("bench");
+	glm::ivec2 first(-world_chunks/2), last = first + world_chunks;
+	for(auto pos : VecIterate(first, last)) {
+		model.GenerateChunk(pos);
+	}
+	model.UpdateActiveRegion();
+}
+
+static std::vector<glm::ivec2> walkableTiles(Model& model, int world_chunks, size_t count, uint32_t seed) {
+	std::mt19937 rng(seed);
+	int half = world_chunks / 2 * Model::Chunk::xsize;
+	std::uniform_int_distribution<int> coord(-half, half - 1);
+	std::vector<glm::ivec2> tiles;
+	while(tiles.size() < count) {
+		glm::ivec2 pos(coord(rng), coord(rng));
+		if(model.TestPlane(Model::Chunk::walkable, pos)) tiles.push_back(pos);
+	}
+	return tiles;
+}
+
+static void benchGeneration() {
+	bench("generate_chunk", json::object(), [](uint64_t n, json&) {
+		Model model;
+		model.LoadConfig("config/config.json");
+		model.SetSeed(std::string("bench"));
+		for(uint64_t i = 0; i < n; i++) {
+			model.GenerateChunk({int(i % 64) - 32, int(i / 64)});
+		}
+	});
+}
+
+static void benchTiles() {
+	Model model;
+	Signals signals;
+	model.LoadConfig("config/config.json");
+	Controller controller(&model, &signals);
+	const int world = 8;
+	makeWorld(model, controller, world);
+	const int half = world / 2 * Model::Chunk::xsize;
+
+	bench("get_tile", {{"order", "sequential"}}, [&](uint64_t n, json&) {
+		uint64_t sum = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			glm::ivec2 pos(int(i % (2*half)) - half, int(i / (2*half) % (2*half)) - half);
+			sum += model.GetTileAt(pos).type;
+		}
+		if(sum == 1) puts("");
+	});
+
+	std::vector<glm::ivec2> random(1 << 16);
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> coord(-half, half - 1);
+	for(auto &p : random) p = {coord(rng), coord(rng)};
+	bench("get_tile", {{"order", "random"}}, [&](uint64_t n, json&) {
+		uint64_t sum = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			sum += model.GetTileAt(random[i & 0xffff]).type;
+		}
+		if(sum == 1) puts("");
+	});
+	bench("test_plane", {{"order", "random"}}, [&](uint64_t n, json&) {
+		uint64_t sum = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			sum += model.TestPlane(Model::Chunk::walkable, random[i & 0xffff]);
+		}
+		if(sum == 1) puts("");
+	});
+
+	// walkable tiles of 64x64 window, one tile at a time against whole plane words
+	bench("count_walkable", {{"method", "tiles"}}, [&](uint64_t n, json& extra) {
+		int count = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			count = 0;
+			for(auto pos : VecIterate(glm::ivec2(-32), glm::ivec2(32))) {
+				count += Model::IsWalkable(model.GetTileAt(pos).type);
+			}
+		}
+		extra["walkable"] = count;
+	});
+	bench("count_walkable", {{"method", "planes"}}, [&](uint64_t n, json& extra) {
+		int count = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			count = model.CountPlane(Model::Chunk::walkable, glm::ivec2(-32), glm::ivec2(32));
+		}
+		extra["walkable"] = count;
+	});
+
+	bench("for_each_object", {{"world_chunks", world}}, [&](uint64_t n, json& extra) {
+		int count = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			count = 0;
+			model.ForEachObject([&](Object*) { count++; });
+		}
+		extra["objects"] = count;
+	});
+}
+
+static void benchSearch() {
+	Model model;
+	Signals signals;
+	model.LoadConfig("config/config.json");
+	Controller controller(&model, &signals);
+	const int world = 8;
+	makeWorld(model, controller, world);
+	auto targets = walkableTiles(model, world, 256, 2);
+
+	for(int radius : {16, 64}) {
+		DistanceMap map;
+		map.SetRadius(radius);
+		// target walks one tile back and forth, so terrain cache only scrolls
+		bench("distance_map", {{"radius", radius}, {"update", "step"}}, [&](uint64_t n, json&) {
+			for(uint64_t i = 0; i < n; i++) {
+				map.Update(&model, targets[0] + glm::ivec2(i & 1, 0));
+			}
+		});
+		bench("distance_map", {{"radius", radius}, {"update", "full"}}, [&](uint64_t n, json&) {
+			for(uint64_t i = 0; i < n; i++) {
+				map.Invalidate();
+				map.Update(&model, targets[i % targets.size()]);
+			}
+		});
+	}
+
+	PathFinder path_finder;
+	std::vector<glm::ivec2> waypoints, path;
+	bench("hpa_path", {{"world_chunks", world}}, [&](uint64_t n, json& extra) {
+		int found = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			glm::ivec2 from = targets[i % targets.size()], to = targets[(i * 7 + 3) % targets.size()];
+			path.clear();
+			if(path_finder.FindPath(&model, from, to, waypoints)) {
+				found++;
+				for(size_t w = 1; w < waypoints.size(); w++) {
+					path_finder.RefineSegment(&model, waypoints[w-1], waypoints[w], path);
+				}
+			}
+		}
+		extra["found_ratio"] = double(found) / n;
+	});
+
+	// sight blockers of window around first target
+	FieldOfView fov;
+	fov.SetRadius(30);
+	glm::ivec2 origin = targets[0] - fov.GetRadius();
+	for(int y = 0; y < fov.GetSize(); y++) {
+		uint64_t row = 0;
+		for(int x = 0; x < fov.GetSize(); x++) {
+			row |= uint64_t(model.TestPlane(Model::Chunk::blocks_sight, origin + glm::ivec2(x, y))) << x;
+		}
+		fov.OpaqueRows()[y] = row;
+	}
+	bench("field_of_view", {{"radius", fov.GetRadius()}}, [&](uint64_t n, json&) {
+		for(uint64_t i = 0; i < n; i++) {
+			fov.Compute();
+		}
+	});
+}
+
+static void benchActors() {
+	for(int actors : {1000, 100000}) {
+		Scheduler scheduler;
+		std::vector<uint32_t> ids;
+		// every actor is scheduled and popped once per operation
+		bench("scheduler", {{"actors", actors}}, [&](uint64_t n, json&) {
+			uint32_t time;
+			for(uint64_t i = 0; i < n; i++) {
+				uint32_t id = i % actors;
+				scheduler.Schedule(id, scheduler.GetTime() + 1 + hash_random(id, i, 0) % 200);
+				if(id == uint32_t(actors - 1)) {
+					while(scheduler.PopDueTick(scheduler.GetTime() + 256, ids, time)) {}
+				}
+			}
+		});
+	}
+
+	// one pass over positions and stats of whole store, like a cheap AI step
+	ActorStore store;
+	const int store_actors = 100000;
+	for(int i = 0; i < store_actors; i++) {
+		store.Add(i + 1, {i % 512, i / 512}, {50, 0, 10, ActorStats::normal_speed});
+	}
+	bench("actor_store_pass", {{"actors", store_actors}}, [&](uint64_t n, json& extra) {
+		int64_t hp = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			uint32_t slot = i % store.Size();
+			store.position[slot] += glm::ivec2(1 - int(i & 2), 0);
+			hp += store.stats[slot].hp;
+		}
+		extra["hp_sum"] = hp;
+	});
+
+	// same pass over layout the store replaced: every actor a heap object owned by set of all
+	// objects, allocated together with its items as generation did, reached through pointers
+	struct HeapActor : Object {
+		HeapActor(glm::ivec2 pos) : Object(Object::Type::actor, pos) {}
+		int hp = 50;
+		int armor = 0;
+		int damage = 10;
+		int speed = ActorStats::normal_speed;
+		uint32_t next_action = 0;
+		std::vector<Item> items;
+	};
+	std::set<std::unique_ptr<HeapActor>> objects;
+	std::vector<HeapActor*> heap_actors;
+	for(int i = 0; i < store_actors; i++) {
+		auto actor = std::make_unique<HeapActor>(glm::ivec2(i % 512, i / 512));
+		if(i % 10 != 0) actor->items.push_back({i % 8, false});
+		heap_actors.push_back(actor.get());
+		objects.insert(std::move(actor));
+	}
+	bench("actor_heap_pass", {{"actors", store_actors}}, [&](uint64_t n, json& extra) {
+		int64_t hp = 0;
+		for(uint64_t i = 0; i < n; i++) {
+			HeapActor* actor = heap_actors[i % heap_actors.size()];
+			actor->position += glm::ivec2(1 - int(i & 2), 0);
+			hp += actor->hp;
+		}
+		extra["hp_sum"] = hp;
+	});
+}
+
+// cost of one empty traced scope
+static void benchTrace() {
+	for(bool enabled : {false, true}) {
+		Trace::Enable(enabled);
+		bench("trace_scope", {{"enabled", enabled}}, [](uint64_t n, json&) {
+			for(uint64_t i = 0; i < n; i++) {
+				TRACE_SCOPE("bench");
+			}
+		});
+	}
+	Trace::Enable(false);
+	Trace::Clear();
+}
+
+// Player walks back and forth, all enemies of active chunks act every turn. Distance map
+// enemies chase on is updated once per turn whatever the crowd, so it is measured alone on
+// the same walk and the rest of turn is reported per actor.
+static void benchTurns() {
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	double distance_map_ns = -1;
+	for(int extra_enemies : {0, 2000, 8000, 20000, 50000}) {
+		for(int threads : {1, 2, 4, 8}) {
+			if(threads > 1 && extra_enemies != 8000) continue;
+			Model model;
+			Signals signals;
+			model.LoadConfig(configWith({{"sim_threads", threads}}));
+			Controller controller(&model, &signals);
+			makeWorld(model, controller, 8);
+			auto &actors = model.GetActors();
+			actors.stats[model.GetPlayerSlot()].hp = 1 << 30;
+
+			// crowd on free tiles of active chunks
+			std::mt19937 rng(3);
+			std::uniform_int_distribution<int> coord(-256, 255);
+			for(int placed = 0, tries = 0; placed < extra_enemies && tries < extra_enemies * 20; tries++) {
+				glm::ivec2 pos(coord(rng), coord(rng)), chunk, local;
+				Model::SplitPosition(pos, chunk, local);
+				if(!model.IsActiveChunk(chunk) || !model.TestPlane(Model::Chunk::walkable, pos) ||
+					model.TestPlane(Model::Chunk::actor, pos) || model.TestPlane(Model::Chunk::item, pos)) continue;
+				model.InsertActor(0, pos, {50, 0, 10, ActorStats::normal_speed});
+				placed++;
+			}
+
+			// direction player can go and come back
+			int keys[2] = {'d', 'a'};
+			glm::ivec2 player = model.GetPlayerPosition();
+			if(!model.TestPlane(Model::Chunk::walkable, player + glm::ivec2(1, 0))) {
+				keys[0] = 's';
+				keys[1] = 'w';
+			}
+			if(distance_map_ns < 0) {
+				DistanceMap map;
+				map.SetRadius(model.GetConfig().chase_radius);
+				glm::ivec2 step = keys[0] == 'd' ? glm::ivec2(1, 0) : glm::ivec2(0, 1);
+				distance_map_ns = bench("ai_turn_distance_map", {{"radius", map.GetRadius()}}, [&](uint64_t n, json&) {
+					for(uint64_t i = 0; i < n; i++) {
+						map.Update(&model, player + step * int(i & 1));
+					}
+				});
+			}
+			double turn_ns = bench("ai_turn", {{"extra_enemies", extra_enemies}, {"threads", threads}, {"cores", cores}}, [&](uint64_t n, json& extra) {
+				uint32_t start = model.GetTurn();
+				for(uint64_t i = 0; i < n; i++) {
+					controller.ProcessInput(keys[i & 1]);
+				}
+				extra["turns"] = model.GetTurn() - start;
+				extra["actors"] = actors.Size();
+			});
+			if(turn_ns > 0 && distance_map_ns > 0) {
+				auto &extra = g_results.back()["extra"];
+				extra["distance_map_ns"] = distance_map_ns;
+				extra["ns_per_actor"] = (turn_ns - distance_map_ns) / actors.Size();
+			}
+		}
+	}
+}
+
+// frames go to a terminal which writes to /dev/null
+static void benchRender() {
+	FILE* null_out = fopen("/dev/null", "w");
+	if(!null_out) return;
+	SCREEN* screen = newterm("xterm", null_out, stdin);
+	if(!screen) {
+		fclose(null_out);
+		return;
+	}
+	set_term(screen);
+	resizeterm(50, 160);
+	{
+		Model model;
+		Signals signals;
+		model.LoadConfig("config/config.json");
+		View view(&model, &signals);
+		Controller controller(&model, &signals);
+		view.Init();
+		controller.StartNewGame("bench");
+		for(int zoom = 0; zoom < Model::zoom_levels; zoom++) {
+			model.SetZoomLevel(zoom);
+			bench("render_game", {{"zoom", zoom}, {"size", {160, 50}}}, [&](uint64_t n, json&) {
+				for(uint64_t i = 0; i < n; i++) {
+					view.Render();
+				}
+			});
+		}
+	}
+	endwin();
+	delscreen(screen);
+	fclose(null_out);
+}
+
+static void benchPersistence() {
+	std::string path = (std::filesystem::temp_directory_path() / "bench_save.json").string();
+	for(int world : {4, 8, 16}) {
+		Model model;
+		Signals signals;
+		model.LoadConfig("config/config.json");
+		Controller controller(&model, &signals);
+		makeWorld(model, controller, world);
+		bench("save_game", {{"world_chunks", world}}, [&](uint64_t n, json& extra) {
+			for(uint64_t i = 0; i < n; i++) {
+				model.SaveGame(path);
+			}
+			extra["bytes"] = std::filesystem::file_size(path);
+		});
+		bench("load_game", {{"world_chunks", world}}, [&](uint64_t n, json&) {
+			for(uint64_t i = 0; i < n; i++) {
+				model.ClearMap();
+				model.LoadGame(path);
+			}
+		});
+	}
+	std::filesystem::remove(path);
+}
+
+// benchmarks of new results matched with base ones by name and params
+static int compare(std::string base_file, std::string new_file) {
+	json base, now;
+	std::ifstream fb(base_file), fn(new_file);
+	if(!fb || !fn) {
+		fprintf(stderr, "can't open %s\n", !fb ? base_file.c_str() : new_file.c_str());
+		return 1;
+	}
+	fb >> base;
+	fn >> now;
+	printf("%-20s %-44s %14s %14s %8s\n", "benchmark", "params", "base ns/op", "ns/op", "speedup");
+	double log_sum = 0;
+	int matched = 0;
+	for(auto &b : now["benchmarks"]) {
+		for(auto &a : base["benchmarks"]) {
+			if(a["name"] != b["name"] || a["params"] != b["params"]) continue;
+			double speedup = a["ns_per_op"].get<double>() / b["ns_per_op"].get<double>();
+			printf("%-20s %-44s %14.1f %14.1f %8.3f\n", b["name"].get<std::string>().c_str(), b["params"].dump().c_str(),
+				a["ns_per_op"].get<double>(), b["ns_per_op"].get<double>(), speedup);
+			log_sum += std::log(speedup);
+			matched++;
+			break;
+		}
+	}
+	if(matched) {
+		printf("geometric mean speedup of %d benchmarks: %.3f\n", matched, std::exp(log_sum / matched));
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if(argc == 4 && std::string(argv[1]) == "--compare") {
+		return compare(argv[2], argv[3]);
+	}
+	std::string out_file;
+	for(int i = 1; i+1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if(arg == "--filter") {
+			g_filter = argv[i+1];
+		} else if(arg == "--min-time") {
+			g_min_time = std::stod(argv[i+1]);
+		} else if(arg == "--out") {
+			out_file = argv[i+1];
+		}
+	}
+
+	benchGeneration();
+	benchTiles();
+	benchSearch();
+	benchActors();
+	benchTrace();
+	benchTurns();
+	benchRender();
+	benchPersistence();
+
+	json report = {
+		{"hardware_threads", std::thread::hardware_concurrency()},
+		{"min_time", g_min_time},
+		{"benchmarks", g_results},
+	};
+	if(out_file.empty()) {
+		printf("%s\n", report.dump(1, '\t').c_str());
+	} else {
+		std::ofstream(out_file) << report.dump(1, '\t') << "\n";
+	}
+	return 0;
+}
@@ -12,8 +12,10 @@
 #include <filesystem>
 #include <cctype>
 #include <chrono>
-#include <thread>
 #include <random>
+#include <algorithm>
+#include <tuple>
+#include <sstream>
 
 #include <fstream>
 
@@ -36,6 +38,10 @@ void Controller::InitMainMenu() {
 	auto back = [=]() {
 		model->PopMenu();
 	};
+	// replay ends where recorded game was quit
+	auto quit = [=]() {
+		if(!replaying) signals->sig_quit();
+	};
 	
 	
 	load_game = std::unique_ptr<Menu>(new Menu {
@@ -54,15 +60,7 @@ void Controller::InitMainMenu() {
 			{MenuItem::Type::button, "<< Back", back},
 		},
 		[=]() {
-			std::string seed = model->GetMenu()->items[0].input;
-			model->ClearMap();
-			if(!seed.empty()) {
-				model->SetSeed(seed);
-			}
-			model->NewGame();
-			model->SetView(ViewType::game);
-			model->SetCameraPos(model->GetPlayerPosition());
-			UpdateCamera();
+			StartNewGame(model->GetMenu()->items[0].input);
 		}
 	});
 	
@@ -71,7 +69,7 @@ void Controller::InitMainMenu() {
 		{
 			{MenuItem::Type::button, "New Game", enter_menu(new_game.get())},
 			{MenuItem::Type::button, "Load Game", enter_menu(load_game.get())},
-			{MenuItem::Type::button, "Quit Game", [=](){signals->sig_quit();}},
+			{MenuItem::Type::button, "Quit Game", quit},
 		}
 	});
 	
@@ -96,93 +94,134 @@ void Controller::InitMainMenu() {
 			{MenuItem::Type::button, "New Game", enter_menu(new_game.get())},
 			{MenuItem::Type::button, "Save Game", enter_menu(save_game.get())},
 			{MenuItem::Type::button, "Load Game", enter_menu(load_game.get())},
-			{MenuItem::Type::button, "Quit Game", [=](){signals->sig_quit();}},
+			{MenuItem::Type::button, "Quit Game", quit},
 		}
 	});
 	
 }
 
-Controller::Controller(Model* _model, Signals* _signals) : model(_model), signals(_signals) {
+Controller::Controller(Model* _model, Signals* _signals) : model(_model), signals(_signals), recording(false), replaying(false) {
 	// must receieve keyboard input from view (as controller doesn't have reference to curses window, on purpose)
 	signals->sig_input.connect(std::bind(&Controller::ProcessInput, this, std::placeholders::_1));
 	signals->sig_canvas_size_changed.connect([=](glm::ivec2 new_size) {
-		model->SetCanvasSize(new_size);
-		UpdateCamera();
+		if(!replaying) {
+			ResizeCanvas(new_size);
+		}
 	});
+	player_distance.SetRadius(model->GetConfig().chase_radius);
+	explore_distance.SetRadius(Model::Chunk::xsize);
+#ifdef __EMSCRIPTEN__
+	workers.SetThreads(1);
+#else
+	int threads = model->GetConfig().sim_threads;
+	workers.SetThreads(threads > 0 ? threads : std::min<int>(8, std::thread::hardware_concurrency()));
+#endif
 	InitMainMenu();
 	model->SetMenu(main_menu.get());
 	model->SetView(ViewType::menu);
 }
 
-void Controller::DoDamage(Actor* a, Actor* b) {
-	model->SetAttackedPos(a->position);
-	a->hp 	 = std::max<int>(0, a->hp - b->damage * std::min<float>(1.0f, 5.0f/a->armor));
-	a->armor = std::max<int>(0, a->armor - b->damage);
+// empty seed keeps current one
+void Controller::StartNewGame(std::string seed) {
+	model->ClearMap();
+	visited_chunks.clear();
+	if(!seed.empty()) {
+		model->SetSeed(seed);
+	}
+	if(recording) {
+		replay.Start(model->GetSeed(), model->GetCanvasSize());
+	}
+	model->NewGame();
+	model->SetView(ViewType::game);
+	model->SetCameraPos(model->GetPlayerPosition());
+	UpdateCamera();
+}
+
+void Controller::LoadGame(std::string savefile) {
+	// loaded game can't be repeated from seed
+	StopRecording();
+	model->ClearMap();
+	visited_chunks.clear();
+	model->LoadGame(savefile);
+	UpdateCamera();
+	model->SetView(ViewType::game);
+}
+
+void Controller::DoDamage(ActorStore::Slot a, ActorStore::Slot b) {
+	TRACE_SCOPE("DoDamage");
+	auto &actors = model->GetActors();
+	auto &sa = actors.stats[a];
+	sa.hp 	 = std::max<int>(0, sa.hp - actors.stats[b].damage * std::min<float>(1.0f, 5.0f/sa.armor));
+	sa.armor = std::max<int>(0, sa.armor - actors.stats[b].damage);
 	
-	if(a->armor == 0) {
-		// erase equipped armor if armor gets to 0
-		a->items.erase(std::remove_if(a->items.begin(), a->items.end(), [&](const Item& i) {
-			return i.equipped && model->GetItemDef(i.idx).armor > a->armor;
-		}), a->items.end());
+	if(sa.armor == 0) {
+		// erase every equipped item giving armor if armor gets to 0, also those in weapon slot
+		actors.items[a].RemoveIf([&](const Item& i) {
+			return i.equipped && model->GetItemDef(i.idx).armor > 0;
+		});
 	}
 	
+	// flash is only scheduled, view plays it while we continue
+	model->QueueEffect(Effect::hit, actors.position[a], std::chrono::milliseconds(model->GetConfig().hit_flash_ms));
 	signals->sig_new_frame();
-	std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
 bool Controller::Move(glm::ivec2 frompos, glm::ivec2 relpos) {
+	TRACE_SCOPE("Move");
+	using Plane = Model::Chunk::Plane;
 	glm::ivec2 old_pos = frompos;
-	auto &old_place = model->GetTileAt(old_pos);
 	// do we have anything movable to move?
-	if(!in(old_place.type, {Tile::Type::enemy,Tile::Type::friendly})) return false;
+	if(!model->TestPlane(Plane::actor, old_pos)) return false;
+	auto &old_place = model->GetTileAt(old_pos);
 	
 	glm::ivec2 new_pos = old_pos + relpos;
+	bool occupied = model->TestPlane(Plane::actor, new_pos);
+	if(!occupied && !model->TestPlane(Plane::walkable, new_pos)) return false;
 	auto &place_to_go = model->GetTileAt(new_pos);
+	auto &actors = model->GetActors();
 	
-	if(in(place_to_go.type, {Tile::Type::empty, Tile::Type::item})) {
+	if(!occupied) {
 		
 		// what to move
-		auto player = static_cast<Actor*>(old_place.obj);
+		ActorStore::Slot mover = actors.Find(old_place.actor);
 		
-		// pickup any items if there
+		// pickup any items if there, enemies carry only what fits inline so waking them never allocates
 		if(place_to_go.type == Tile::Type::item) {
-			player->items.push_back( static_cast<ItemObject*>(place_to_go.obj)->item );
+			if(old_place.type == Tile::Type::enemy && actors.items[mover].Size() >= Inventory::inline_capacity) return false;
+			actors.items[mover].Push( static_cast<ItemObject*>(place_to_go.obj)->item );
 			model->RemoveObject(place_to_go.obj);
 		}
 		
 		// move to pos
-		place_to_go.type = old_place.type;
-		place_to_go.obj = old_place.obj;
-		old_place.type = Tile::Type::empty;
-		old_place.obj = 0;
-		player->position = new_pos;
+		model->SetTile(new_pos, old_place.type, nullptr, old_place.actor);
+		model->SetTile(old_pos, Tile::Type::empty, 0);
+		actors.position[mover] = new_pos;
 		
 	} else {
 		
 		// attack enemy
-		if(in(place_to_go.type, {Tile::Type::enemy, Tile::Type::friendly}) && place_to_go.type != old_place.type) {
-			auto player = static_cast<Actor*>(old_place.obj);
-			auto target = static_cast<Actor*>(place_to_go.obj);
+		if(place_to_go.type != old_place.type) {
+			ActorStore::Slot attacker = actors.Find(old_place.actor);
+			ActorStore::Slot target = actors.Find(place_to_go.actor);
 			
-			DoDamage(player, target);
-			DoDamage(target, player);
+			DoDamage(attacker, target);
+			DoDamage(target, attacker);
 
-			if(target->hp <= 0) {
-				place_to_go.type = Tile::Type::empty;
-				
+			// player stays in store when dead, dead dialog is shown below
+			if(actors.stats[target].hp <= 0 && place_to_go.actor != model->GetPlayerId()) {
 				// drop some item if has any
-				if(!target->items.empty()) {
-					place_to_go.type = Tile::Type::item;
-					auto item = new ItemObject(target->items.front(), new_pos);
-					model->RemoveObject(place_to_go.obj);
-					place_to_go.obj = item;
-					model->InsertObject(item);
+				if(!actors.items[target].Empty()) {
+					auto item = model->NewItemObject(actors.items[target][0], new_pos);
+					model->RemoveActor(place_to_go.actor);
+					model->SetTile(new_pos, Tile::Type::item, item);
 				} else {
-					// remove from list
-					model->RemoveObject(place_to_go.obj);
+					// remove from store
+					model->RemoveActor(place_to_go.actor);
+					model->SetTile(new_pos, Tile::Type::empty, 0);
 				}
 			}
-			if(model->GetPlayer()->hp <= 0) {
+			// removal moved last actor into target slot, so player is found again
+			if(actors.stats[model->GetPlayerSlot()].hp <= 0) {
 				// you are dead dialog
 				static Menu you_are_dead {
 					"DEAD",
@@ -193,7 +232,6 @@ bool Controller::Move(glm::ivec2 frompos, glm::ivec2 relpos) {
 				model->SetMenu(&you_are_dead);
 				model->SetView(ViewType::menu);
 			}
-			model->SetAttackedPos({-1,-1});
 		} else {
 			return false;
 		}
@@ -202,67 +240,298 @@ bool Controller::Move(glm::ivec2 frompos, glm::ivec2 relpos) {
 	return true;
 }
 
+// Enemies due before player's next action act tick by tick. Actors of one tick are grouped
+// by chunk and chunks are colored by parity of their coordinates, so chunks of one color
+// never touch and run in parallel. There actors only walk inside their own chunk, leaving it,
+// attacks and pickups are deferred and done afterwards one by one in scheduling order.
+// Random choices are hashed from seed, tick and actor id, so result doesn't depend on thread count.
+void Controller::UpdateEnemies() {
+	using Chunk = Model::Chunk;
+	static const glm::ivec2 dirs[] = {{-1,0}, {0,-1}, {0,1}, {1,0}};
+	
+	PROFILE_SCOPE(model->GetProfiler(), Profiler::ai);
+	TRACE_SCOPE("UpdateEnemies");
+	
+	// enemies near player go downhill on shared distance map, others move randomly
+	auto &actors = model->GetActors();
+	player_distance.Update(model, model->GetPlayerPosition());
+	uint32_t until = model->GetTime() + Model::ActionDelay(actors.stats[model->GetPlayerSlot()].speed);
+	while(model->PopDueActors(until, due)) {
+		uint32_t tick = model->GetTime();
+		
+		// order by color, chunk and scheduling order, slots stay valid until deferred moves
+		groups.clear();
+		order.resize(due.size());
+		for(uint32_t i = 0; i < due.size(); i++) {
+			ActorStore::Slot slot = actors.Find(due[i]);
+			glm::ivec2 chunk_pos, local;
+			Model::SplitPosition(actors.position[slot], chunk_pos, local);
+			order[i] = {chunk_pos, (chunk_pos.x & 1) | (chunk_pos.y & 1) << 1, i, slot};
+		}
+		std::sort(order.begin(), order.end(), [](const DueActor& a, const DueActor& b) {
+			return std::tie(a.color, a.chunk.x, a.chunk.y, a.index) < std::tie(b.color, b.chunk.x, b.chunk.y, b.index);
+		});
+		for(uint32_t i = 0; i < order.size(); i++) {
+			if(i == 0 || order[i].chunk != order[i-1].chunk) {
+				groups.push_back({model->FindChunk(order[i].chunk), i, i});
+			}
+			groups.back().end = i + 1;
+		}
+		
+		deferred.assign(due.size(), glm::ivec2(0));
+		auto run_group = [&](int g) {
+			TRACE_SCOPE("EnemyGroup");
+			ChunkGroup& group = groups[g];
+			for(uint32_t i = group.begin; i < group.end; i++) {
+				ActorStore::Slot slot = order[i].slot;
+				glm::ivec2 position = actors.position[slot];
+				glm::ivec2 step = player_distance.GetStep(position);
+				if(step == glm::ivec2(0,0)) {
+					uint32_t choice = hash_random(model->GetSeed(), tick, due[order[i].index]) % 5;
+					if(choice == 4) continue; // stand in place
+					step = dirs[choice];
+				}
+				glm::ivec2 to = position + step;
+				glm::ivec2 chunk_pos, local;
+				Model::SplitPosition(to, chunk_pos, local);
+				Chunk* chunk = group.chunk;
+				bool free = chunk && chunk_pos == order[i].chunk && chunk->planes[Chunk::walkable].Test(local) &&
+					!chunk->planes[Chunk::actor].Test(local) && !chunk->planes[Chunk::item].Test(local);
+				if(free) {
+					model->SetTile(to, Tile::Type::enemy, nullptr, due[order[i].index]);
+					model->SetTile(position, Tile::Type::empty, 0);
+					actors.position[slot] = to;
+				} else {
+					deferred[order[i].index] = step;
+				}
+			}
+		};
+		// waking threads costs more than moving a few hundred actors
+		const size_t min_parallel_actors = 512;
+		for(uint32_t begin = 0; begin < groups.size(); ) {
+			int color = order[groups[begin].begin].color;
+			uint32_t end = begin;
+			while(end < groups.size() && order[groups[end].begin].color == color) end++;
+			if(due.size() >= min_parallel_actors) {
+				workers.Run(end - begin, [&](int g) { run_group(begin + g); });
+			} else {
+				for(uint32_t g = begin; g < end; g++) run_group(g);
+			}
+			begin = end;
+		}
+		
+		for(uint32_t i = 0; i < due.size(); i++) {
+			ActorStore::Slot slot = actors.Find(due[i]);
+			if(slot == ActorStore::invalid) continue;
+			// chunks outside of active region are dormant, only sleepChunk brings actors there
+			glm::ivec2 chunk_pos, local;
+			Model::SplitPosition(actors.position[slot] + deferred[i], chunk_pos, local);
+			if(deferred[i] != glm::ivec2(0,0) && model->IsActiveChunk(chunk_pos)) {
+				Move(actors.position[slot], deferred[i]);
+				slot = actors.Find(due[i]);
+			}
+			model->ScheduleActor(slot);
+		}
+	}
+}
+
+bool Controller::stepPlayer(glm::ivec2 dir) {
+	// if player can't move that direction, don't move enemies either
+	if(!Move(model->GetPlayerPosition(), dir)) return false;
+	if(!model->IsFogEnabled()) {
+		glm::ivec2 chunk_pos, lpos;
+		Model::SplitPosition(model->GetPlayerPosition(), chunk_pos, lpos);
+		visited_chunks.insert(chunk_pos);
+	}
+	
+	model->NextTurn();
+	
+	// we moved, update our camera if needed
+	UpdateCamera();
+	
+	UpdateEnemies();
+	return true;
+}
+
+// seen enemy close enough to chase player, only actors in sight window are looked at
+bool Controller::enemyInSight() {
+	glm::ivec2 player = model->GetPlayerPosition();
+	player_distance.Update(model, player);
+	model->FindInSight(Model::Chunk::actor, player_distance.GetRadius(), in_sight);
+	for(auto &pos : in_sight) {
+		if(pos != player && player_distance.GetDistance(pos) != DistanceMap::unreachable) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// item in sight that wasn't seen when travel started (seen_items is sorted)
+bool Controller::newItemInSight() {
+	model->FindInSight(Model::Chunk::item, FieldOfView::max_radius, in_sight);
+	for(auto &pos : in_sight) {
+		if(!std::binary_search(seen_items.begin(), seen_items.end(), pos, vec2_cmp<glm::ivec2>())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// without fog nothing gets explored, chunks player stood in count instead
+bool Controller::isExplored(const glm::ivec2& pos) {
+	if(model->IsFogEnabled()) return model->IsExplored(pos);
+	glm::ivec2 chunk_pos, lpos;
+	Model::SplitPosition(pos, chunk_pos, lpos);
+	return visited_chunks.count(chunk_pos);
+}
+
+// goal is nearest walkable tile not seen yet (not in visited chunk without fog),
+// path to it goes downhill on distances from goal
+bool Controller::planExplore() {
+	using Chunk = Model::Chunk;
+	travel_path.clear();
+	bool fog = model->IsFogEnabled();
+	glm::ivec2 player = model->GetPlayerPosition();
+	if(!fog) {
+		glm::ivec2 chunk_pos, lpos;
+		Model::SplitPosition(player, chunk_pos, lpos);
+		visited_chunks.insert(chunk_pos);
+	}
+	
+	explore_distance.Update(model, player);
+	int radius = explore_distance.GetRadius();
+	glm::ivec2 first, last, lpos;
+	Model::SplitPosition(player - radius, first, lpos);
+	Model::SplitPosition(player + radius, last, lpos);
+	
+	uint16_t best = DistanceMap::unreachable;
+	glm::ivec2 goal;
+	for(auto chunk_pos : VecIterate(first, last + 1)) {
+		Chunk* chunk = model->FindChunk(chunk_pos);
+		if(!chunk || !chunk->generated || (!fog && visited_chunks.count(chunk_pos))) continue;
+		glm::ivec2 origin = chunk_pos * Model::chunk_size;
+		for(int y = 0; y < BitPlane::size; y++) {
+			uint64_t bits = chunk->planes[Chunk::walkable].rows[y] & (fog ? ~chunk->explored.rows[y] : ~uint64_t(0));
+			for(; bits; bits &= bits - 1) {
+				glm::ivec2 pos = origin + glm::ivec2(__builtin_ctzll(bits), y);
+				uint16_t dist = explore_distance.GetDistance(pos);
+				if(dist < best) {
+					best = dist;
+					goal = pos;
+				}
+			}
+		}
+	}
+	if(best == DistanceMap::unreachable) return false;
+	
+	for(glm::ivec2 pos = goal; pos != player; pos += explore_distance.GetStep(pos)) {
+		travel_path.push_back(pos);
+	}
+	return true;
+}
+
+// steps are simulated like key presses, only the last one is drawn
+void Controller::travel(bool explore) {
+	auto &actors = model->GetActors();
+	ActorStore::Slot player = model->GetPlayerSlot();
+	int hp = actors.stats[player].hp;
+	int items = actors.items[player].Size();
+	model->FindInSight(Model::Chunk::item, FieldOfView::max_radius, seen_items);
+	std::sort(seen_items.begin(), seen_items.end(), vec2_cmp<glm::ivec2>());
+	for(int step = 0; step < max_travel_steps && !enemyInSight() && !newItemInSight(); step++) {
+		// goal seen on the way isn't worth walking to anymore
+		if(explore && (travel_path.empty() || isExplored(travel_path.front())) && !planExplore()) break;
+		if(travel_path.empty()) break;
+		
+		// never attack on the way, actor in path ends travel
+		glm::ivec2 dir = travel_path.back() - model->GetPlayerPosition();
+		if(std::abs(dir.x) + std::abs(dir.y) != 1 || model->TestPlane(Model::Chunk::actor, travel_path.back())) break;
+		if(!stepPlayer(dir)) break;
+		travel_path.pop_back();
+		
+		player = model->GetPlayerSlot();
+		if(model->GetView() != ViewType::game || actors.stats[player].hp < hp || actors.items[player].Size() > items) break;
+	}
+	travel_path.clear();
+	signals->sig_new_frame();
+}
+
+void Controller::AutoExplore() {
+	travel_path.clear();
+	travel(true);
+}
+
+void Controller::TravelTo(glm::ivec2 target) {
+	travel_path.clear();
+	std::vector<glm::ivec2> waypoints;
+	if(path_finder.FindPath(model, model->GetPlayerPosition(), target, waypoints)) {
+		for(size_t i = 1; i < waypoints.size(); i++) {
+			path_finder.RefineSegment(model, waypoints[i-1], waypoints[i], travel_path);
+		}
+		std::reverse(travel_path.begin(), travel_path.end());
+	}
+	travel(false);
+}
+
 void Controller::UpdateCamera() {
-	auto player = model->GetPlayer();
-	if(player) {
+	TRACE_SCOPE("UpdateCamera");
+	if(model->GetPlayerId()) {
 		// move camera position if needed
 		glm::ivec2 campos = model->GetCameraPos();
 		glm::ivec2 canvas = model->GetCanvasSize();
 		glm::ivec2 playerpos = model->GetPlayerPosition();
 		glm::ivec2 dist   = glm::abs(playerpos-campos) >= canvas/2 * 3/4;
 		model->SetCameraPos(campos + dist * (glm::sign(playerpos-campos)));
-		model->SetAttackedPos(campos - canvas);
 		
 		// generate m_chunks if needed
 		for(auto v : VecIterate((campos-canvas)/Model::chunk_size-1, (campos+canvas)/Model::chunk_size + 1)) {
 			model->GenerateChunk(v);
 		}
+		
+		// chunks around player exist now, so sight can be cast
+		model->UpdateFieldOfView();
+		model->UpdateActiveRegion();
 	}
 }
 
 void Controller::ToggleItemsDialog() {
-	auto player = model->GetPlayer();
-	auto back = [=](){
+	// player slot can change between turns, so it is looked up when menu is used
+	auto &actors = model->GetActors();
+	auto back = [=, &actors](){
 		// remove consumed items
-		auto erased = std::remove_if(player->items.begin(), player->items.end(), [](const Item& itm) { return itm.idx == -1; });
-		player->items.erase( erased, player->items.end() );
+		actors.items[model->GetPlayerSlot()].RemoveIf([](const Item& itm) { return itm.idx == -1; });
 	};
 	if(model->GetView() == ViewType::game) {
 		// make new items menu
 		items_menu = std::unique_ptr<Menu>(new Menu({ "ITEMS", {}, noaction, back }));
 		// populate items menu with player items
 		int i=0;
-		for(auto& itm : player->items) {
+		for(auto& itm : actors.items[model->GetPlayerSlot()]) {
 			auto itm_def = model->GetItemDef(itm.idx);
 			std::string name = std::string(itm_def.consumable ? "c" : "e") + " " + itm_def.name;
 			items_menu->items.push_back(MenuItem {
-				MenuItem::Type::toggle, name, [=](){
-					auto& item = player->items[i];
+				MenuItem::Type::toggle, name, [=, &actors](){
+					ActorStore::Slot player = model->GetPlayerSlot();
+					auto& items = actors.items[player];
+					auto& stats = actors.stats[player];
+					auto& item = items[i];
 					auto& item_def = model->GetItemDef(item.idx);
 					
 					// prevent equipping 2 items of same type
-					if(!item_def.consumable && !item.equipped) {
-						if(std::find_if(player->items.begin(), player->items.end(), [=](const Item& itm1) {
-							if(itm1.idx != -1 && itm1.equipped) {
-								auto itm1_def = model->GetItemDef(itm1.idx);
-								return (bool)(item_def.damage * itm1_def.damage + item_def.hp * itm1_def.hp + item_def.armor * itm1_def.armor);
-							}
-							return false;
-						}) != player->items.end()) {
-							model->GetSelectedItem().input_cursor = 0; // block menu toggle effect
-							return;
-						}
+					if(!item_def.consumable && !item.equipped && items.GetEquipped(item_def.slot) >= 0) {
+						model->GetSelectedItem().input_cursor = 0; // block menu toggle effect
+						return;
 					}
 					
 					// if player has less armor than equipped armor, then unequipping will destroy such item
-					bool consumable = item_def.consumable || (item.equipped && item_def.armor > player->armor);
-					item.equipped 	^= true; // toggle equip
+					bool consumable = item_def.consumable || (item.equipped && item_def.armor > stats.armor);
+					items.SetEquipped(i, item_def.slot, !item.equipped); // toggle equip
 					
 					
 					// equip item or unequip it
-					player->hp 		= glm::max(0, player->hp 	 + (item.equipped ? 1 : -1) * item_def.hp);
-					player->armor 	= glm::max(0, player->armor  + (item.equipped ? 1 : -1) * item_def.armor);
-					player->damage 	= glm::max(0, player->damage + (item.equipped ? 1 : -1) * item_def.damage);
+					stats.hp 		= glm::max(0, stats.hp 	   + (item.equipped ? 1 : -1) * item_def.hp);
+					stats.armor 	= glm::max(0, stats.armor  + (item.equipped ? 1 : -1) * item_def.armor);
+					stats.damage 	= glm::max(0, stats.damage + (item.equipped ? 1 : -1) * item_def.damage);
 					
 					// remove item if consumable
 					if(consumable) {
@@ -288,14 +557,7 @@ void Controller::ToggleItemsDialog() {
 void Controller::UpdateLoadGameMenu() {
 	// fill load game menu with list of saved games
 	auto load = [=](){
-		// load game
-		std::string savefile = model->GetSelectedItem().name;
-		model->ClearMap();
-		model->LoadGame(savefile);
-		model->ClearMap();
-		model->LoadGame(savefile);
-		UpdateCamera();
-		model->SetView(ViewType::game);
+		LoadGame(model->GetSelectedItem().name);
 	};
 	
 	load_game->items.clear();
@@ -332,7 +594,105 @@ void Controller::ToggleSaveGameDialog() {
 	signals->sig_new_frame();
 }
 
+void Controller::ToggleTravelDialog() {
+	static Menu travel_menu {
+		"TRAVEL",
+		{
+			{MenuItem::Type::inputfield, "Travel to x y: ", noaction, 15},
+			{MenuItem::Type::button, "<< Back", [=](){model->SetView(ViewType::game);}},
+		},
+		[=](){
+			glm::ivec2 target;
+			std::istringstream input(model->GetSelectedItem().input);
+			model->SetView(ViewType::game);
+			if(input >> target.x >> target.y) {
+				TravelTo(target);
+			}
+		}
+	};
+	
+	model->SetMenu(&travel_menu);
+	model->SetView(ViewType::gamemenu);
+	signals->sig_new_frame();
+}
+
+void Controller::ResizeCanvas(glm::ivec2 size) {
+	if(recording && replay.IsStarted()) {
+		replay.RecordResize(size);
+	}
+	model->SetCanvasSize(size);
+	UpdateCamera();
+}
+
+void Controller::StartRecording(std::string filename) {
+	replay_file = filename;
+	recording = true;
+	// before view, which exits on quit
+	signals->sig_quit.connect([=](){ StopRecording(); }, boost::signals2::at_front);
+}
+
+void Controller::StopRecording() {
+	if(!recording) return;
+	recording = false;
+	replay.Save(replay_file);
+}
+
+void Controller::StartTracing(std::string filename) {
+	trace_file = filename;
+	Trace::Enable(true);
+	signals->sig_quit.connect([=](){ SaveTrace(); }, boost::signals2::at_front);
+}
+
+void Controller::SaveTrace() {
+	if(trace_file.empty()) return;
+	Trace::Save(trace_file);
+}
+
+Replay::Result Controller::PlayReplay(const Replay& recorded, std::function<void()> on_key) {
+	replaying = true;
+	model->SetCanvasSize(recorded.GetCanvas());
+	model->SetSeed(recorded.GetSeed());
+	StartNewGame("");
+	
+	Replay::Result result = {};
+	auto &keys = recorded.GetKeys();
+	auto &checkpoints = recorded.GetCheckpoints();
+	size_t next = 0;
+	for(uint32_t i = 0; i < keys.size(); i++) {
+		if(keys[i] == Replay::resize_key && i + 2 < keys.size()) {
+			ResizeCanvas({keys[i+1], keys[i+2]});
+			i += 2;
+		} else {
+			ProcessInput(keys[i]);
+		}
+		for(; next < checkpoints.size() && checkpoints[next].key == i; next++) {
+			if(checkpoints[next].turn == model->GetTurn() && checkpoints[next].hash == model->GetStateHash()) {
+				result.passed++;
+			} else if(result.failed++ == 0) {
+				result.first_failed_turn = checkpoints[next].turn;
+			}
+		}
+		on_key();
+	}
+	result.turns = model->GetTurn();
+	replaying = false;
+	return result;
+}
+
+// key is recorded before handling, so key starting new game is dropped by restarted recording
 void Controller::ProcessInput(int c) {
+	PROFILE_SCOPE(model->GetProfiler(), Profiler::input);
+	TRACE_SCOPE("ProcessInput");
+	if(recording) {
+		replay.RecordKey(c);
+	}
+	handleInput(c);
+	if(recording) {
+		replay.RecordCheckpoint(model);
+	}
+}
+
+void Controller::handleInput(int c) {
 	
 	static std::map<int, glm::ivec2> input_map {
 		// wasd keys
@@ -367,7 +727,7 @@ void Controller::ProcessInput(int c) {
 				item.input.erase(item.input_cursor, 1);
 			} else {
 				// insert character into inputfield
-				if(item.input.size() < item.max_input && (std::isalnum(c) || std::isspace(c)) && c != '\n') {
+				if(item.input.size() < item.max_input && (std::isalnum(c) || std::isspace(c) || c == '-') && c != '\n') {
 					item.input.insert(item.input_cursor, 1, c);
 					item.input_cursor = std::min<int>(item.input.size(), item.input_cursor+1);
 				}
@@ -403,11 +763,24 @@ void Controller::ProcessInput(int c) {
 		ToggleItemsDialog();
 	}
 	
+	// write trace so far (ctrl-t)
+	if(c == 20 && !trace_file.empty()) {
+		SaveTrace();
+	}
+	
 	// save game dialog (ctrl-s)
 	if(c == 19 && (model->GetView() == ViewType::game)) {
 		ToggleSaveGameDialog();
 	}
 	
+	// auto explore (x key) and travel to position (t key)
+	if(c == 'x' && (model->GetView() == ViewType::game)) {
+		AutoExplore();
+	}
+	if(c == 't' && (model->GetView() == ViewType::game)) {
+		ToggleTravelDialog();
+	}
+	
 	// main menu dialog (ESC)
 	// TODO: fix ESC needs pressing twice or couple of times for its reaction
 	if(c == 27 && (model->GetView() == ViewType::game)) {
@@ -417,6 +790,18 @@ void Controller::ProcessInput(int c) {
 		signals->sig_new_frame();
 	}
 	
+	// zoom out/in map (-/+ keys), toggle minimap (m key) and timings overlay (p key)
+	if(model->GetView() == ViewType::game && in<int>(c, {'-', '+', '=', 'm', 'p'})) {
+		if(c == 'm') {
+			model->ToggleMinimap();
+		} else if(c == 'p') {
+			model->ToggleProfiler();
+		} else {
+			model->SetZoomLevel(model->GetZoomLevel() + (c == '-' ? 1 : -1));
+		}
+		signals->sig_new_frame();
+	}
+	
 	// process arrow keys
 	auto it = input_map.find(c);
 	if(it != input_map.end()) {
@@ -427,23 +812,7 @@ void Controller::ProcessInput(int c) {
 			}
 		} else {
 			// move player
-			if(Move(model->GetPlayerPosition(), it->second)) { // if player can't move that direction, don't move enemies either
-				
-				// we moved, update our camera if needed
-				UpdateCamera();
-				
-				// move enemies randomly, after player moves
-				static std::default_random_engine re;
-				std::uniform_int_distribution<int> unif(0,4);
-				std::string keys = "wasd";
-				model->ForEachObject([&](Object* o) {
-					if(o->type == Object::Type::actor) {
-						int move_choice = unif(re);
-						if(move_choice == 4) return; // stand in place
-						Move(o->position, input_map[keys[move_choice]]);
-					}
-				});
-			}
+			stepPlayer(it->second);
 			signals->sig_new_frame();
 		}
 	}
@@ -1,19 +1,80 @@
 #pragma once
 #include "Model.hpp"
 #include "Signals.hpp"
+#include "DistanceMap.hpp"
+#include "PathFinder.hpp"
+#include "WorkerPool.hpp"
+#include "Replay.hpp"
 
 class Controller {
 public:
 	Controller(Model* _model, Signals* _signals);
+	void StartNewGame(std::string seed);
+	void LoadGame(std::string savefile);
 	bool Move(glm::ivec2 frompos, glm::ivec2 relpos);
-	void DoDamage(Actor* a, Actor* b);
+	void DoDamage(ActorStore::Slot a, ActorStore::Slot b);
 	void ToggleItemsDialog();
 	void ToggleSaveGameDialog();
 	void UpdateLoadGameMenu();
 	void UpdateCamera();
 	void InitMainMenu();
 	void ProcessInput(int c);
+	void ResizeCanvas(glm::ivec2 size);
+	void UpdateEnemies();
+	// games started from now on are recorded, file is written on quit or stop
+	void StartRecording(std::string filename);
+	void StopRecording();
+	// hot paths are traced from now on, trace is written on ctrl-t and on quit
+	void StartTracing(std::string filename);
+	void SaveTrace();
+	// starts recorded game and presses its keys, on_key is called after every key
+	Replay::Result PlayReplay(const Replay& replay, std::function<void()> on_key);
+	// walk without rendering until destination, enemy in sight, pickup or damage
+	void AutoExplore();
+	void TravelTo(glm::ivec2 target);
+	void ToggleTravelDialog();
 private:
+	static constexpr int max_travel_steps = 500;
+	
+	void handleInput(int c);
+	bool stepPlayer(glm::ivec2 dir);
+	bool enemyInSight();
+	bool newItemInSight();
+	bool planExplore();
+	bool isExplored(const glm::ivec2& pos);
+	void travel(bool explore);
+	
+	struct DueActor {
+		glm::ivec2 	chunk;
+		int 		color;
+		uint32_t 	index; // into due
+		ActorStore::Slot slot;
+	};
+	struct ChunkGroup {
+		Model::Chunk* 	chunk;
+		uint32_t 		begin, end; // range of order
+	};
+	
+
 	Model* 	 model;
 	Signals* signals;
+	DistanceMap player_distance; // enemies chase player using this
+	DistanceMap explore_distance; // from player to nearest unexplored tile
+	std::set<glm::ivec2, vec2_cmp<glm::ivec2>> visited_chunks; // player stood in them, explored without fog
+	PathFinder 	path_finder;
+	std::vector<glm::ivec2> travel_path; // next step at back
+	std::vector<glm::ivec2> seen_items; // in sight when travel started, sorted
+	std::vector<glm::ivec2> in_sight; // scratch of sight queries
+	Replay 		replay;
+	std::string replay_file;
+	bool 		recording;
+	bool 		replaying; // canvas follows replay, not terminal
+	std::string trace_file;
+	WorkerPool 	workers;
+	
+	// enemy turn scratch
+	std::vector<uint32_t> 	due; // actor ids
+	std::vector<DueActor> 	order;
+	std::vector<ChunkGroup> groups;
+	std::vector<glm::ivec2> deferred;
 };
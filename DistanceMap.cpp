@@ -0,0 +1,122 @@
+#include "DistanceMap.hpp"
+#include <algorithm>
+
+DistanceMap::DistanceMap() : m_radius(0), m_size(1), m_valid(false), m_terrain_version(0) {}
+
+void DistanceMap::SetRadius(int radius) {
+	m_radius = std::max(0, radius);
+	m_size = 2*m_radius + 1;
+	m_walkable.assign(m_size*m_size, 0);
+	m_distance.assign(m_size*m_size, unreachable);
+	m_queue.resize(m_size*m_size);
+	m_valid = false;
+}
+
+int DistanceMap::GetRadius() const {
+	return m_radius;
+}
+
+void DistanceMap::Invalidate() {
+	m_valid = false;
+}
+
+int DistanceMap::cacheIndex(glm::ivec2 pos) const {
+	pos = neg_mod(pos % m_size, glm::ivec2(m_size));
+	return pos.y*m_size + pos.x;
+}
+
+// copy walkability of tiles in [from, to) into toroidal cache
+void DistanceMap::fetchTerrain(Model* model, glm::ivec2 from, glm::ivec2 to) {
+	for(int y = from.y; y < to.y; y++) {
+		Model::Chunk* chunk = nullptr;
+		glm::ivec2 last_chunk_pos;
+		for(int x = from.x; x < to.x; x++) {
+			glm::ivec2 chunk_pos, local;
+			Model::SplitPosition({x,y}, chunk_pos, local);
+			if(!chunk || chunk_pos != last_chunk_pos) {
+				chunk = model->FindChunk(chunk_pos);
+				last_chunk_pos = chunk_pos;
+			}
+			// not generated terrain is treated as wall
+			m_walkable[cacheIndex({x,y})] = chunk && chunk->generated && chunk->planes[Model::Chunk::walkable].Test(local);
+		}
+	}
+}
+
+void DistanceMap::Update(Model* model, glm::ivec2 target) {
+	if(m_radius == 0) return;
+	bool terrain_changed = m_terrain_version != model->GetTerrainVersion();
+	if(m_valid && !terrain_changed && target == m_target) return;
+
+	glm::ivec2 move = target - m_target;
+	glm::ivec2 origin = target - m_radius;
+	if(!m_valid || terrain_changed || std::abs(move.x) + std::abs(move.y) != 1) {
+		fetchTerrain(model, origin, origin + m_size);
+	} else if(move.x != 0) {
+		// only one column entered the window, it replaces the one that left
+		int x = move.x > 0 ? origin.x + m_size - 1 : origin.x;
+		fetchTerrain(model, {x, origin.y}, {x+1, origin.y + m_size});
+	} else {
+		int y = move.y > 0 ? origin.y + m_size - 1 : origin.y;
+		fetchTerrain(model, {origin.x, y}, {origin.x + m_size, y+1});
+	}
+	m_target = target;
+	m_origin = origin;
+	m_terrain_version = model->GetTerrainVersion();
+	m_valid = true;
+
+	// Breadth first search from target (all steps cost 1, so it is Dijkstra) over whole window,
+	// also when target moved one tile. Grid is bipartite, so distance of every reachable tile
+	// then goes up or down by exactly one, repairing the old field would rewrite all of it too
+	// and could not tell the direction without searching.
+	std::fill(m_distance.begin(), m_distance.end(), unreachable);
+	glm::ivec2 cache_origin = neg_mod(origin % m_size, glm::ivec2(m_size));
+	int head = 0, tail = 0;
+	int start = m_radius*m_size + m_radius;
+	m_distance[start] = 0;
+	m_queue[tail++] = start;
+	while(head < tail) {
+		int i = m_queue[head++];
+		int lx = i % m_size;
+		int ly = i / m_size;
+		uint16_t dist = m_distance[i] + 1;
+
+		auto visit = [&](int x, int y) {
+			if(x < 0 || y < 0 || x >= m_size || y >= m_size) return;
+			int ni = y*m_size + x;
+			if(m_distance[ni] != unreachable) return;
+			int cx = x + cache_origin.x, cy = y + cache_origin.y;
+			cx -= (cx >= m_size) * m_size;
+			cy -= (cy >= m_size) * m_size;
+			if(!m_walkable[cy*m_size + cx]) return;
+			m_distance[ni] = dist;
+			m_queue[tail++] = ni;
+		};
+		visit(lx-1, ly);
+		visit(lx+1, ly);
+		visit(lx, ly-1);
+		visit(lx, ly+1);
+	}
+}
+
+uint16_t DistanceMap::GetDistance(glm::ivec2 pos) const {
+	if(!m_valid) return unreachable;
+	glm::ivec2 l = pos - m_origin;
+	if(l.x < 0 || l.y < 0 || l.x >= m_size || l.y >= m_size) return unreachable;
+	return m_distance[l.y*m_size + l.x];
+}
+
+glm::ivec2 DistanceMap::GetStep(glm::ivec2 pos) const {
+	static const glm::ivec2 dirs[] = {{-1,0}, {0,-1}, {0,1}, {1,0}};
+	uint16_t best = GetDistance(pos);
+	glm::ivec2 step(0,0);
+	if(best == unreachable) return step;
+	for(auto &d : dirs) {
+		uint16_t dist = GetDistance(pos + d);
+		if(dist < best) {
+			best = dist;
+			step = d;
+		}
+	}
+	return step;
+}
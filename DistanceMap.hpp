@@ -0,0 +1,41 @@
+#pragma once
+#include "Model.hpp"
+#include <vector>
+#include <cstdint>
+
+// Dijkstra map: walking distance to a target (player) over walkable terrain,
+// kept for a square window of given radius around the target.
+// Any number of actors can then step towards target in O(1) each.
+class DistanceMap {
+public:
+	static constexpr uint16_t unreachable = 0xffff;
+
+	DistanceMap();
+	void 		SetRadius(int radius);
+	int 		GetRadius() const;
+
+	// recompute for new target position, terrain cache is only scrolled
+	// when target moved by one tile and terrain didn't change, distances
+	// are always searched again
+	void 		Update(Model* model, glm::ivec2 target);
+	void 		Invalidate();
+
+	uint16_t 	GetDistance(glm::ivec2 pos) const;
+	// direction to neighbor closer to target, {0,0} if there is none
+	glm::ivec2 	GetStep(glm::ivec2 pos) const;
+
+private:
+	void 		fetchTerrain(Model* model, glm::ivec2 from, glm::ivec2 to);
+	int 		cacheIndex(glm::ivec2 pos) const;
+
+	int 		m_radius;
+	int 		m_size; // window is m_size x m_size, m_size = 2*radius+1
+	bool 		m_valid;
+	glm::ivec2 	m_target;
+	glm::ivec2 	m_origin; // world position of window top left corner
+	uint32_t 	m_terrain_version;
+
+	std::vector<uint8_t> 	m_walkable; // toroidal cache, indexed by world position modulo m_size
+	std::vector<uint16_t> 	m_distance; // indexed by position relative to m_origin
+	std::vector<int> 		m_queue;
+};
@@ -0,0 +1,94 @@
+#include "FieldOfView.hpp"
+#include <algorithm>
+
+static int floor_div(int a, int b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int ceil_div(int a, int b) {
+	return -floor_div(-a, b);
+}
+
+FieldOfView::FieldOfView() {
+	SetRadius(0);
+}
+
+void FieldOfView::SetRadius(int radius) {
+	m_radius = glm::clamp(radius, 0, max_radius);
+	m_size = 2*m_radius + 1;
+	m_opaque.assign(m_size, 0);
+	m_visible.assign(m_size, 0);
+}
+
+int FieldOfView::GetRadius() const {
+	return m_radius;
+}
+
+int FieldOfView::GetSize() const {
+	return m_size;
+}
+
+std::vector<uint64_t>& FieldOfView::OpaqueRows() {
+	return m_opaque;
+}
+
+const std::vector<uint64_t>& FieldOfView::VisibleRows() const {
+	return m_visible;
+}
+
+bool FieldOfView::IsVisible(glm::ivec2 local) const {
+	if(local.x < 0 || local.y < 0 || local.x >= m_size || local.y >= m_size) return false;
+	return (m_visible[local.y] >> local.x) & 1;
+}
+
+// scans rows of each quadrant outwards, a row is split into new rows by walls in it
+void FieldOfView::Compute() {
+	std::fill(m_visible.begin(), m_visible.end(), 0);
+	const int c = m_radius;
+	m_visible[c] |= uint64_t(1) << c;
+	const int max_dist = m_radius*m_radius + m_radius; // rounder circle than radius^2
+	
+	for(int quadrant = 0; quadrant < 4; quadrant++) {
+		// north, east, south, west
+		auto transform = [&](int depth, int col) {
+			switch(quadrant) {
+				case 0: return glm::ivec2(c + col, c - depth);
+				case 1: return glm::ivec2(c + depth, c + col);
+				case 2: return glm::ivec2(c + col, c + depth);
+				default: return glm::ivec2(c - depth, c + col);
+			}
+		};
+		
+		m_stack.clear();
+		m_stack.push_back(Row{1, -1, 1, 1, 1});
+		while(!m_stack.empty()) {
+			Row row = m_stack.back();
+			m_stack.pop_back();
+			if(row.depth > m_radius) continue;
+			
+			// columns whose centers fall between slopes, ties rounded inwards
+			int min_col = floor_div(2*row.depth*row.start_num + row.start_den, 2*row.start_den);
+			int max_col = ceil_div(2*row.depth*row.end_num - row.end_den, 2*row.end_den);
+			int prev_wall = -1;
+			for(int col = min_col; col <= max_col; col++) {
+				glm::ivec2 p = transform(row.depth, col);
+				bool wall = (m_opaque[p.y] >> p.x) & 1;
+				bool symmetric = col*row.start_den >= row.depth*row.start_num && col*row.end_den <= row.depth*row.end_num;
+				if((wall || symmetric) && row.depth*row.depth + col*col <= max_dist) {
+					m_visible[p.y] |= uint64_t(1) << p.x;
+				}
+				if(prev_wall == 1 && !wall) {
+					row.start_num = 2*col - 1;
+					row.start_den = 2*row.depth;
+				}
+				if(prev_wall == 0 && wall) {
+					m_stack.push_back(Row{row.depth + 1, row.start_num, row.start_den, 2*col - 1, 2*row.depth});
+				}
+				prev_wall = wall;
+			}
+			if(prev_wall == 0) {
+				m_stack.push_back(Row{row.depth + 1, row.start_num, row.start_den, row.end_num, row.end_den});
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// Symmetric shadowcasting over a square window of (2*radius+1)^2 tiles with
+// the viewer in its center. Window rows are single words (bit x is column x),
+// caller fills opaque rows and reads visible rows back, so no tile lookups happen here.
+class FieldOfView {
+public:
+	static constexpr int max_radius = 31;
+	
+	FieldOfView();
+	void 		SetRadius(int radius);
+	int 		GetRadius() const;
+	int 		GetSize() const;
+	
+	std::vector<uint64_t>& 			OpaqueRows();
+	const std::vector<uint64_t>& 	VisibleRows() const;
+	void 		Compute();
+	
+	// position relative to window top left corner
+	bool 		IsVisible(glm::ivec2 local) const;
+
+private:
+	// slopes are fractions, start <= column/depth <= end
+	struct Row {
+		int depth;
+		int start_num, start_den;
+		int end_num, end_den;
+	};
+	
+	int 	m_radius;
+	int 	m_size;
+	std::vector<uint64_t> 	m_opaque;
+	std::vector<uint64_t> 	m_visible;
+	std::vector<Row> 		m_stack;
+};
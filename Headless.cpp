@@ -0,0 +1,454 @@
+#include "Model.hpp"
+#include "Controller.hpp"
+#include "AllocTracker.hpp"
+#include "PathFinder.hpp"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+// Model and controller without terminal, driven by key script or by random walking bot.
+// Recorded game can be replayed instead, checkpoint hashes then tell whether it went the same.
+// --check-allocs fails if walking and fighting in already generated area allocates memory.
+// --check-dormancy fails if an actor stays live outside of active region.
+// --soak plays long with save and load round trips and fails on drift or growing memory.
+// usage: headless [--seed s] [--turns n] [--script file] [--record file] [--replay file] [--trace file] [--counters] [--stats]
+//                 [--check-allocs] [--check-dormancy] [--soak] [--save-every n]
+
+static long peakRssKb() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss; // kilobytes on linux
+}
+
+// resident set size now, peak one where it can't be read
+static long rssKb() {
+	long pages = 0, resident = 0;
+	FILE* f = fopen("/proc/self/statm", "r");
+	if(f) {
+		if(fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+		fclose(f);
+	}
+	return resident ? resident * (sysconf(_SC_PAGESIZE) / 1024) : peakRssKb();
+}
+
+// timings of turn phases, with hardware counters per call when they were counted
+static void printPhases(Profiler& profiler) {
+	printf("%-9s %8s %8s %8s %9s %6s %9s %9s\n", "phase", "calls", "p50 us", "p99 us", "kcycles", "ipc", "llc miss", "br miss");
+	for(int i = 0; i < Profiler::num_phases; i++) {
+		auto phase = Profiler::Phase(i);
+		auto stats = profiler.GetStats(phase);
+		if(stats.count == 0) continue;
+		printf("%-9s %8lu %8.1f %8.1f", Profiler::GetName(phase), (unsigned long)stats.count, stats.p50_ns / 1e3, stats.p99_ns / 1e3);
+		auto &totals = profiler.GetCounterTotals(phase);
+		if(profiler.IsCounting() && totals.samples) {
+			auto &v = totals.values.v;
+			double calls = totals.samples;
+			double ipc = v[PerfCounters::cycles] ? double(v[PerfCounters::instructions]) / v[PerfCounters::cycles] : 0;
+			printf(" %9.1f %6.2f %9.1f %9.1f", v[PerfCounters::cycles] / calls / 1000, ipc,
+				v[PerfCounters::llc_misses] / calls, v[PerfCounters::branch_misses] / calls);
+		}
+		printf("\n");
+	}
+}
+
+// live memory of model by category against configured budgets
+static void printMemory(Model& model) {
+	MemoryStats memory = model.GetMemoryStats();
+	auto &budgets = model.GetConfig().memory_budget_kb;
+	printf("%-9s %10s %10s\n", "memory", "KB", "budget KB");
+	for(int i = 0; i < MemoryStats::num_categories; i++) {
+		auto category = MemoryStats::Category(i);
+		printf("%-9s %10zu", MemoryStats::GetName(category), memory.bytes[i] / 1024);
+		if(budgets[i] > 0) {
+			printf(" %10d%s", budgets[i], model.IsOverBudget(category) ? " over budget" : "");
+		}
+		printf("\n");
+	}
+	printf("%-9s %10zu\n", "total", memory.Total() / 1024);
+	printf("resident chunks: %zu, objects: %zu, actors: %zu\n", model.GetResidentChunks(), model.GetObjectCount(), model.GetActors().Size());
+}
+
+// Bot walks back and forth between start and a tile three chunks east, so chunks left behind go
+// to sleep and wake up again on the way back. After two trips scratch buffers, pools and dormant
+// lists have grown to their working size, from then on a turn must not allocate on any thread.
+// Turns that generate a chunk, crowd more actors than ever into a dormant chunk or add to a full
+// inventory are skipped, world, dormant records and inventories only ever grow. Bot plans its
+// way between measured turns.
+static int checkAllocations(Model& model, Controller& controller, std::string seed, uint32_t turns) {
+	const uint32_t warm_up_legs = 4;
+	model.SetCanvasSize({80, 24});
+	controller.StartNewGame(seed);
+	auto &actors = model.GetActors();
+	actors.stats[model.GetPlayerSlot()].hp = 1 << 30; // fights go on
+
+	// far end is first tile around the point reachable from start
+	glm::ivec2 start = model.GetPlayerPosition(), start_chunk, local;
+	Model::SplitPosition(start, start_chunk, local);
+	for(auto pos : VecIterate(start_chunk + glm::ivec2(-1, -1), start_chunk + glm::ivec2(5, 2))) {
+		model.GenerateChunk(pos);
+	}
+	model.UpdateActiveRegion();
+	PathFinder path_finder;
+	std::vector<glm::ivec2> waypoints, path;
+	glm::ivec2 ends[2] = {start, start};
+	for(auto pos : VecIterate(glm::ivec2(-16), glm::ivec2(16))) {
+		glm::ivec2 end = start + glm::ivec2(3 * Model::Chunk::xsize, 0) + pos;
+		if(model.TestPlane(Model::Chunk::walkable, end) && path_finder.FindPath(&model, start, end, waypoints)) {
+			ends[1] = end;
+			break;
+		}
+	}
+	if(ends[1] == start) {
+		printf("FAILED: no way from start three chunks east\n");
+		return 1;
+	}
+
+	// only full inventories allocate on pickup, by id as slots move
+	std::vector<std::pair<uint32_t, size_t>> full;
+	auto inventoryGrew = [&]() {
+		for(auto &f : full) {
+			ActorStore::Slot slot = actors.Find(f.first);
+			if(slot != ActorStore::invalid && actors.items[slot].GetHeapBytes() != f.second) return true;
+		}
+		return false;
+	};
+	uint32_t legs = 0, measured = 0, skipped = 0;
+	AllocTracker::Counts allocs = {};
+	for(size_t press = 0; press < size_t(turns) * 40 && measured < turns; press++) {
+		glm::ivec2 player = model.GetPlayerPosition();
+		if(player == ends[(legs + 1) % 2]) legs++;
+		// fights and blocking actors push bot off its way, then it plans again
+		if(path.empty() || std::abs(path.back().x - player.x) + std::abs(path.back().y - player.y) != 1) {
+			path.clear();
+			if(path_finder.FindPath(&model, player, ends[(legs + 1) % 2], waypoints)) {
+				for(size_t i = 1; i < waypoints.size(); i++) {
+					path_finder.RefineSegment(&model, waypoints[i-1], waypoints[i], path);
+				}
+				std::reverse(path.begin(), path.end());
+			}
+		}
+		int key = 'w';
+		if(!path.empty()) {
+			glm::ivec2 dir = path.back() - player;
+			key = dir.x > 0 ? 'd' : dir.x < 0 ? 'a' : dir.y > 0 ? 's' : 'w';
+		}
+
+		uint32_t turn = model.GetTurn();
+		size_t chunks = model.GetGeneratedChunks();
+		size_t chunk_meta = model.GetMemoryStats().bytes[MemoryStats::chunk_meta];
+		full.clear();
+		for(ActorStore::Slot slot = 0; slot < actors.Size(); slot++) {
+			if(actors.items[slot].Size() >= Inventory::inline_capacity) full.push_back({actors.id[slot], actors.items[slot].GetHeapBytes()});
+		}
+		AllocTracker::Counts before = AllocTracker::TotalCounts();
+		controller.ProcessInput(key);
+		AllocTracker::Counts after = AllocTracker::TotalCounts();
+		if(!path.empty() && model.GetPlayerPosition() == path.back()) path.pop_back();
+		if(legs < warm_up_legs) continue;
+
+		if(model.GetGeneratedChunks() != chunks || model.GetMemoryStats().bytes[MemoryStats::chunk_meta] > chunk_meta || inventoryGrew()) {
+			skipped++;
+			continue;
+		}
+		measured += model.GetTurn() - turn;
+		allocs.allocations += after.allocations - before.allocations;
+		allocs.bytes += after.bytes - before.bytes;
+	}
+	printf("trips between ends: %u\n", legs / 2);
+	printf("steady turns: %u (skipped %u)\n", measured, skipped);
+	printf("allocations: %lu (%lu bytes)\n", (unsigned long)allocs.allocations, (unsigned long)allocs.bytes);
+	if(allocs.allocations) {
+		printf("FAILED: steady turns allocate\n");
+		return 1;
+	}
+	return 0;
+}
+
+// Bot auto explores and walks randomly, after every key press each live actor must be inside
+// active region (actors of other chunks are dormant records).
+static int checkDormancy(Model& model, Controller& controller, std::string seed, uint32_t turns) {
+	model.SetCanvasSize({80, 24});
+	controller.StartNewGame(seed);
+
+	static const int bot_keys[] = {'x', 'w', 'a', 's', 'd'};
+	std::mt19937 bot(model.GetSeed());
+	auto &actors = model.GetActors();
+	actors.stats[model.GetPlayerSlot()].hp = 1 << 30; // walk goes on through fights
+	uint32_t played = 0;
+	size_t worst = 0;
+	for(size_t press = 0; press < size_t(turns) * 10 && played < turns; press++) {
+		uint32_t turn = model.GetTurn();
+		controller.ProcessInput(bot_keys[bot() % 5]);
+		played += model.GetTurn() - turn;
+
+		size_t outside = 0;
+		for(ActorStore::Slot slot = 0; slot < actors.Size(); slot++) {
+			glm::ivec2 chunk_pos, lpos;
+			Model::SplitPosition(actors.position[slot], chunk_pos, lpos);
+			if(!model.IsActiveChunk(chunk_pos)) outside++;
+		}
+		if(outside > worst) {
+			printf("FAILED: %zu live actors outside active region at turn %u\n", outside, model.GetTurn());
+			worst = outside;
+		}
+	}
+	printf("turns: %u\n", played);
+	printf("chunks generated: %zu\n", model.GetGeneratedChunks());
+	return worst ? 1 : 0;
+}
+
+// lowest value of each quarter after the first (warm up) keeps rising by more than slack,
+// memory that is never given back does that while normal use goes up and down
+static bool risingFloor(const std::vector<size_t>& samples, double slack) {
+	size_t quarter = samples.size() / 4;
+	if(quarter < 2) return false;
+	size_t floors[3];
+	for(int q = 0; q < 3; q++) {
+		auto begin = samples.begin() + quarter * (q+1);
+		auto end = q == 2 ? samples.end() : begin + quarter;
+		floors[q] = *std::min_element(begin, end);
+	}
+	return floors[0] < floors[1] && floors[1] < floors[2] && floors[2] > floors[0] * (1.0 + slack);
+}
+
+// Bot plays (and dies and starts over) for given turns. Every save_every turns game is saved
+// and loaded back, world hash must be the same after it. Rss, objects and model memory are
+// printed at each round trip. Object count and model memory follow the world bot is in, so
+// leaks are told by rss and by heap blocks still live whenever the map is cleared for a new world.
+static int soak(Model& model, Controller& controller, std::string seed, uint32_t turns, uint32_t save_every) {
+	std::string savefile = (std::filesystem::temp_directory_path() / "headless-soak.json").string();
+	auto liveBlocks = []() {
+		AllocTracker::Counts counts = AllocTracker::TotalCounts();
+		return size_t(counts.allocations - counts.frees);
+	};
+	model.SetCanvasSize({80, 24});
+	controller.StartNewGame(seed);
+
+	static const int bot_keys[] = {'w', 'a', 's', 'd'};
+	std::mt19937 bot(model.GetSeed());
+	std::vector<size_t> rss, cleared_blocks;
+	uint32_t played = 0, deaths = 0, next_save = save_every;
+	int failed = 0;
+	auto start = std::chrono::steady_clock::now();
+	printf("%10s %9s %8s %7s %7s %10s %16s\n", "turn", "rss KB", "objects", "actors", "chunks", "memory KB", "world hash");
+	for(size_t press = 0; press < size_t(turns) * 10 && played < turns; press++) {
+		uint32_t turn = model.GetTurn();
+		controller.ProcessInput(bot_keys[bot() % 4]);
+		played += model.GetTurn() - turn;
+
+		if(model.GetActors().stats[model.GetPlayerSlot()].hp <= 0) {
+			deaths++;
+			model.ClearMap();
+			cleared_blocks.push_back(liveBlocks());
+			controller.StartNewGame(seed + std::to_string(deaths));
+		}
+		if(played < next_save) continue;
+		next_save += save_every;
+
+		uint64_t hash = model.GetWorldHash();
+		model.SaveGame(savefile);
+		controller.LoadGame(savefile);
+		uint64_t loaded = model.GetWorldHash();
+
+		rss.push_back(rssKb());
+		printf("%10u %9zu %8zu %7zu %7zu %10zu %016lx\n", played, rss.back(), model.GetObjectCount(), model.GetActors().Size(),
+			model.GetResidentChunks(), model.GetMemoryStats().Total() / 1024, (unsigned long)hash);
+		if(loaded != hash) {
+			printf("FAILED: save and load changed world at turn %u (%016lx after load)\n", model.GetTurn(), (unsigned long)loaded);
+			failed = 1;
+			break;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::filesystem::remove(savefile);
+
+	printf("turns: %u\n", played);
+	printf("turns per second: %.0f\n", played / std::max(seconds, 1e-9));
+	printf("round trips: %zu\n", rss.size());
+	printf("deaths: %u\n", deaths);
+	printf("peak rss: %ld KB\n", peakRssKb());
+	if(!cleared_blocks.empty()) {
+		printf("live heap blocks with cleared map: first %zu, last %zu\n", cleared_blocks.front(), cleared_blocks.back());
+	}
+	if(rss.size() < 8 || cleared_blocks.size() < 8) {
+		printf("too few samples to tell growth, use more turns or smaller --save-every\n");
+	}
+	// rss follows biggest world so far, so it gets more slack
+	if(risingFloor(rss, 0.25)) {
+		printf("FAILED: rss keeps growing\n");
+		failed = 1;
+	}
+	if(risingFloor(cleared_blocks, 0.05)) {
+		printf("FAILED: heap blocks left after clearing map keep growing\n");
+		failed = 1;
+	}
+	return failed;
+}
+
+int main(int argc, char** argv) {
+	std::string seed = "headless";
+	std::string script_file, record_file, replay_file, trace_file;
+	uint32_t turns = 1000, save_every = 0;
+	bool counters = false, stats = false, check_allocs = false, check_dormancy = false, soak_test = false;
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool has_value = i+1 < argc;
+		if(arg == "--counters") {
+			counters = true;
+		} else if(arg == "--stats") {
+			stats = true;
+		} else if(arg == "--check-allocs") {
+			check_allocs = true;
+		} else if(arg == "--check-dormancy") {
+			check_dormancy = true;
+		} else if(arg == "--soak") {
+			soak_test = true;
+		} else if(arg == "--save-every" && has_value) {
+			save_every = std::stoul(argv[++i]);
+		} else if(arg == "--seed" && has_value) {
+			seed = argv[++i];
+		} else if(arg == "--turns" && has_value) {
+			turns = std::stoul(argv[++i]);
+		} else if(arg == "--script" && has_value) {
+			script_file = argv[++i];
+		} else if(arg == "--record" && has_value) {
+			record_file = argv[++i];
+		} else if(arg == "--replay" && has_value) {
+			replay_file = argv[++i];
+		} else if(arg == "--trace" && has_value) {
+			trace_file = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--seed s] [--turns n] [--script file] [--record file] [--replay file] [--trace file] [--counters] [--stats] [--check-allocs] [--check-dormancy] [--soak] [--save-every n]\n", argv[0]);
+			return 1;
+		}
+	}
+	// counters are read only by PROFILE_SCOPE, without it they would stay empty
+#ifndef PROFILER
+	if(counters) {
+		fprintf(stderr, "--counters needs build with profile := true\n");
+		return 1;
+	}
+#endif
+
+	// script is a sequence of game keys, whitespace is skipped
+	std::string script;
+	if(!script_file.empty()) {
+		std::ifstream f(script_file);
+		if(!f) {
+			fprintf(stderr, "can't open %s\n", script_file.c_str());
+			return 1;
+		}
+		for(char c : std::string(std::istreambuf_iterator<char>(f), {})) {
+			if(!std::isspace((unsigned char)c)) script += c;
+		}
+	}
+
+	Model model;
+	Signals signals;
+	model.LoadConfig("config/config.json");
+	Controller controller(&model, &signals);
+	if(!trace_file.empty()) {
+		controller.StartTracing(trace_file);
+	}
+	if(counters && !model.GetProfiler().EnableCounters(true)) {
+		printf("hardware counters: not available\n");
+	}
+
+	if(!replay_file.empty()) {
+		Replay replay;
+		if(!replay.Load(replay_file)) {
+			fprintf(stderr, "can't read replay %s\n", replay_file.c_str());
+			return 1;
+		}
+		auto start = std::chrono::steady_clock::now();
+		auto result = controller.PlayReplay(replay, [](){});
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		controller.SaveTrace();
+		printf("turns: %u\n", result.turns);
+		printf("turns per second: %.0f\n", result.turns / std::max(seconds, 1e-9));
+		printf("checkpoints passed: %d\n", result.passed);
+		printf("checkpoints failed: %d\n", result.failed);
+		if(result.failed) {
+			printf("first failed checkpoint at turn %u\n", result.first_failed_turn);
+		}
+		printf("peak rss: %ld KB\n", peakRssKb());
+		if(counters) {
+			printPhases(model.GetProfiler());
+		}
+		if(stats) {
+			printMemory(model);
+		}
+		return result.failed ? 1 : 0;
+	}
+
+	if(check_allocs) {
+		return checkAllocations(model, controller, seed, turns);
+	}
+	if(check_dormancy) {
+		return checkDormancy(model, controller, seed, turns);
+	}
+	if(soak_test) {
+		// 64 samples by default
+		int result = soak(model, controller, seed, turns, save_every ? save_every : std::max(1u, turns / 64));
+		if(stats) {
+			printMemory(model);
+		}
+		return result;
+	}
+	if(!record_file.empty()) {
+		controller.StartRecording(record_file);
+	}
+	// canvas decides how far around camera chunks get generated
+	model.SetCanvasSize({80, 24});
+	controller.StartNewGame(seed);
+
+	static const int bot_keys[] = {'w', 'a', 's', 'd'};
+	std::mt19937 bot(model.GetSeed());
+	// bot bumping into walls doesn't spend turns, so key presses are limited too
+	size_t max_presses = script_file.empty() ? size_t(turns) * 10 : script.size();
+	uint32_t played = 0, deaths = 0;
+	size_t chunks = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	AllocTracker::Counts allocs_before = AllocTracker::TotalCounts();
+	for(size_t press = 0; press < max_presses && played < turns; press++) {
+		uint32_t turn = model.GetTurn();
+		controller.ProcessInput(script_file.empty() ? bot_keys[bot() % 4] : script[press]);
+		played += model.GetTurn() - turn;
+
+		// dead player is sent to menu, bot starts over in new world
+		if(model.GetActors().stats[model.GetPlayerSlot()].hp <= 0) {
+			deaths++;
+			if(!script_file.empty()) break;
+			chunks += model.GetGeneratedChunks();
+			controller.StartNewGame(seed + std::to_string(deaths));
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t allocations = AllocTracker::TotalCounts().allocations - allocs_before.allocations;
+	chunks += model.GetGeneratedChunks();
+	controller.StopRecording();
+	controller.SaveTrace();
+
+	printf("turns: %u\n", played);
+	printf("turns per second: %.0f\n", played / std::max(seconds, 1e-9));
+	printf("chunks generated: %zu\n", chunks);
+	printf("deaths: %u\n", deaths);
+	printf("allocations: %lu (%.1f per turn)\n", (unsigned long)allocations, double(allocations) / std::max(played, 1u));
+	printf("peak rss: %ld KB\n", peakRssKb());
+	if(counters) {
+		printPhases(model.GetProfiler());
+	}
+	if(stats) {
+		printMemory(model);
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include "Inventory.hpp"
+#include <algorithm>
+#include <iterator>
+
+Inventory::Inventory() : m_size(0), m_spilled(false) {
+	std::fill(std::begin(m_equipped), std::end(m_equipped), -1);
+}
+
+Inventory::Inventory(std::initializer_list<Item> items) : Inventory() {
+	for(auto &i : items) {
+		Push(i);
+	}
+}
+
+void Inventory::Push(Item item, EquipSlot slot) {
+	if(!m_spilled && m_size == inline_capacity) {
+		m_heap.assign(m_inline, m_inline + m_size);
+		m_spilled = true;
+	}
+	if(m_spilled) {
+		m_heap.push_back(item);
+	} else {
+		m_inline[m_size++] = item;
+	}
+	if(item.equipped && slot != EquipSlot::none) {
+		m_equipped[(int)slot] = Size() - 1;
+	}
+}
+
+void Inventory::Erase(int i) {
+	RemoveIf([&, r = 0](const Item&) mutable { return r++ == i; });
+}
+
+void Inventory::Clear() {
+	m_heap.clear();
+	m_size = 0;
+	m_spilled = false;
+	std::fill(std::begin(m_equipped), std::end(m_equipped), -1);
+}
+
+int Inventory::GetEquipped(EquipSlot slot) const {
+	return slot == EquipSlot::none ? -1 : m_equipped[(int)slot];
+}
+
+void Inventory::SetEquipped(int i, EquipSlot slot, bool equipped) {
+	data()[i].equipped = equipped;
+	if(slot == EquipSlot::none) return;
+	if(equipped) {
+		m_equipped[(int)slot] = i;
+	} else if(m_equipped[(int)slot] == i) {
+		m_equipped[(int)slot] = -1;
+	}
+}
+
+int Inventory::Size() const {
+	return m_spilled ? (int)m_heap.size() : m_size;
+}
+
+bool Inventory::Empty() const {
+	return Size() == 0;
+}
+
+size_t Inventory::GetHeapBytes() const {
+	return m_heap.capacity() * sizeof(Item);
+}
+
+Item& Inventory::operator[](int i) {
+	return data()[i];
+}
+
+const Item& Inventory::operator[](int i) const {
+	return data()[i];
+}
+
+Item* Inventory::begin() {
+	return data();
+}
+
+Item* Inventory::end() {
+	return data() + Size();
+}
+
+const Item* Inventory::begin() const {
+	return data();
+}
+
+const Item* Inventory::end() const {
+	return data() + Size();
+}
+
+Item* Inventory::data() {
+	return m_spilled ? m_heap.data() : m_inline;
+}
+
+const Item* Inventory::data() const {
+	return m_spilled ? m_heap.data() : m_inline;
+}
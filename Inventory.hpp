@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+struct Item {
+	int idx = 0;
+	bool equipped = false; // items on ground never are
+};
+
+enum class EquipSlot : uint8_t {
+	weapon,
+	armor,
+	trinket,
+	none
+};
+
+// Items of one actor. First inline_capacity items are stored in place, only bigger
+// inventories go to heap. Equipped item of every slot is indexed, so checking
+// whether a slot is taken doesn't scan items.
+class Inventory {
+public:
+	static constexpr int inline_capacity = 4;
+	static constexpr int num_slots = (int)EquipSlot::none;
+
+	Inventory();
+	Inventory(std::initializer_list<Item> items);
+
+	// equipped item is registered in slot
+	void 		Push(Item item, EquipSlot slot = EquipSlot::none);
+	void 		Erase(int i);
+	void 		Clear();
+	// removes marked items, keeps slots pointing to their items
+	template<class Pred>
+	void 		RemoveIf(Pred pred);
+
+	// index of item equipped in slot, -1 if slot is free
+	int 		GetEquipped(EquipSlot slot) const;
+	void 		SetEquipped(int i, EquipSlot slot, bool equipped);
+
+	int 		Size() const;
+	bool 		Empty() const;
+	size_t 		GetHeapBytes() const;
+	Item& 		operator[](int i);
+	const Item& operator[](int i) const;
+	Item* 		begin();
+	Item* 		end();
+	const Item* begin() const;
+	const Item* end() const;
+
+private:
+	Item* 		data();
+	const Item* data() const;
+
+	Item 				m_inline[inline_capacity];
+	std::vector<Item> 	m_heap; // all items once inventory outgrew inline storage
+	uint8_t 			m_size; // inline item count
+	bool 				m_spilled;
+	int16_t 			m_equipped[num_slots];
+};
+
+template<class Pred>
+void Inventory::RemoveIf(Pred pred) {
+	Item* items = data();
+	int n = Size(), w = 0;
+	for(int r = 0; r < n; r++) {
+		bool remove = pred(items[r]);
+		for(auto &e : m_equipped) {
+			if(e == r) e = remove ? -1 : w;
+		}
+		if(!remove) items[w++] = items[r];
+	}
+	if(m_spilled) {
+		m_heap.resize(w);
+	} else {
+		m_size = w;
+	}
+}
@@ -1,17 +1,72 @@
 #include "Model.hpp"
 #include "View.hpp"
 #include "Controller.hpp"
+#include <cstdio>
+#include <string>
 
-int main() {
+// usage: game [--record file] [--replay file] [--trace file] [--counters]
+int main(int argc, char** argv) {
+	std::string record_file, replay_file, trace_file;
+	bool counters = false;
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool has_value = i+1 < argc;
+		if(arg == "--counters") {
+			counters = true;
+		} else if(arg == "--record" && has_value) {
+			record_file = argv[++i];
+		} else if(arg == "--replay" && has_value) {
+			replay_file = argv[++i];
+		} else if(arg == "--trace" && has_value) {
+			trace_file = argv[++i];
+		}
+	}
+	// counters are read only by PROFILE_SCOPE, without it they would stay empty
+#ifndef PROFILER
+	if(counters) {
+		fprintf(stderr, "--counters needs build with profile := true\n");
+		return 1;
+	}
+#endif
+	
+	Replay replay;
+	if(!replay_file.empty() && !replay.Load(replay_file)) {
+		fprintf(stderr, "can't read replay %s\n", replay_file.c_str());
+		return 1;
+	}
+	
 	Model model;
 	Signals signals;
 	View view(&model, &signals);
 	
 	model.LoadConfig("config/config.json");
 	Controller controller(&model, &signals);
+	// timings overlay shows them, message is seen after game ends
+	if(counters && !model.GetProfiler().EnableCounters(true)) {
+		fprintf(stderr, "hardware counters are not available\n");
+	}
 	view.Init();
 	
-	// render initial frame
+	if(!record_file.empty()) {
+		controller.StartRecording(record_file);
+	}
+	if(!trace_file.empty()) {
+		controller.StartTracing(trace_file);
+	}
+	
+	// replay is drawn after every key as fast as possible, then game ends
+	if(!replay_file.empty()) {
+		auto result = controller.PlayReplay(replay, [&](){ view.Render(); });
+		controller.SaveTrace();
+		endwin();
+		printf("replayed %u turns, checkpoints passed: %d, failed: %d\n", result.turns, result.passed, result.failed);
+		if(result.failed) {
+			printf("first failed checkpoint at turn %u\n", result.first_failed_turn);
+		}
+		return result.failed ? 1 : 0;
+	}
+	
+	// request initial frame, rendered by first GetInput
 	signals.sig_new_frame();
 	
 	while(1) {
@@ -5,12 +5,25 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <cmath>
 
 #include <stdint.h>
 #include "OpenSimplexNoise/OpenSimplexNoise/OpenSimplexNoise.h"
 
 Model::Model() {
 	m_view = ViewType::menu;
+	m_zoom_level = 0;
+	m_terrain_version = 0;
+	m_fov_terrain_version = 0;
+	m_turn = 0;
+	m_active_valid = false;
+	m_over_budget = 0;
+	m_budget_check_turn = 0;
+	m_last_object_id = 0;
+	m_iterating = false;
+	m_fov.SetRadius(m_config.fov_radius);
+	m_minimap = true;
+	m_profiler_shown = false;
 	m_seed = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 }
 
@@ -23,60 +36,675 @@ Model::Chunk& Model::GetChunk(const glm::ivec2& pos) {
 	return it->second;
 }
 
-Tile& Model::GetTileAt(const glm::ivec2& pos) {
+Model::Chunk* Model::FindChunk(const glm::ivec2& pos) {
+	auto it = m_chunks.find(pos);
+	return it != m_chunks.end() ? &it->second : nullptr;
+}
+
+void Model::SplitPosition(const glm::ivec2& pos, glm::ivec2& chunk, glm::ivec2& lpos) {
 	static glm::ivec2 chunk_size(Chunk::xsize,Chunk::ysize);
-	glm::ivec2 chunk = pos / chunk_size;
-	glm::ivec2 lpos = pos % chunk_size;
+	chunk = pos / chunk_size;
+	lpos = pos % chunk_size;
 	
 	// use negative modulus so we can properly access negative values
 	chunk -= (lpos < 0);
 	lpos = (lpos < 0) * chunk_size + lpos;
-	
+}
+
+Tile& Model::GetTileAt(const glm::ivec2& pos) {
+	glm::ivec2 chunk, lpos;
+	SplitPosition(pos, chunk, lpos);
 	return GetChunk(chunk).TileAt(lpos);
 }
 
+// actors and items stand on empty ground, they don't change terrain summary
+static Tile::Type terrain(Tile::Type type) {
+	return in(type, {Tile::friendly, Tile::enemy, Tile::item}) ? Tile::empty : type;
+}
+
+static bool is_actor(Tile::Type type) {
+	return type == Tile::friendly || type == Tile::enemy;
+}
+
+// terrain which can be walked on, ignoring who stands there
+bool Model::IsWalkable(Tile::Type type) {
+	return terrain(type) == Tile::empty;
+}
+
+// changes whenever walkability of any tile may have changed
+uint32_t Model::GetTerrainVersion() const {
+	return m_terrain_version;
+}
+
+size_t Model::GetGeneratedChunks() const {
+	return m_generated_chunks.size();
+}
+
+size_t Model::GetResidentChunks() const {
+	return m_chunks.size();
+}
+
+// items lying on map, actors are counted by their store
+size_t Model::GetObjectCount() const {
+	return m_objects.size();
+}
+
+size_t MemoryStats::Total() const {
+	size_t total = 0;
+	for(auto b : bytes) total += b;
+	return total;
+}
+
+const char* MemoryStats::GetName(Category category) {
+	static const char* names[num_categories] = {"tiles", "meta", "objects", "items", "lod_fov", "generate"};
+	return names[category];
+}
+
+MemoryStats Model::GetMemoryStats() {
+	MemoryStats stats = {};
+	auto &b = stats.bytes;
+	const size_t tree_node = 4 * sizeof(void*); // color, parent and children of map and set nodes
+	size_t chunks = m_chunks.size();
+	b[MemoryStats::chunk_tiles] = chunks * sizeof(Chunk::tiles);
+	b[MemoryStats::lod_fov] = chunks * sizeof(Chunk::lod) + 2 * m_fov.GetSize() * sizeof(uint64_t);
+	b[MemoryStats::chunk_meta] = chunks * (sizeof(Chunk) - sizeof(Chunk::tiles) - sizeof(Chunk::lod) + sizeof(glm::ivec2) + tree_node);
+	for(auto &it : m_chunks) {
+		b[MemoryStats::chunk_meta] += it.second.dormant_actors.capacity() * sizeof(DormantActor) +
+			it.second.dormant_inventories.capacity() * sizeof(Item) + it.second.dormant_items.capacity() * sizeof(DormantItem);
+	}
+	
+	size_t inventories = m_actors.items.capacity() * sizeof(Inventory);
+	for(auto &items : m_actors.items) {
+		inventories += items.GetHeapBytes();
+	}
+	b[MemoryStats::inventories] = inventories;
+	size_t item_objects = m_objects.size() + m_free_objects.size();
+	b[MemoryStats::objects] = item_objects * (sizeof(ItemObject) + sizeof(std::unique_ptr<Object>) + tree_node) +
+		m_free_objects.capacity() * sizeof(m_free_objects[0]) + m_actors.GetMemoryUsage() - m_actors.items.capacity() * sizeof(Inventory);
+	b[MemoryStats::generation] = (m_generated_chunks.size() + m_objects_generated_chunks.size()) * (sizeof(glm::ivec2) + tree_node);
+	return stats;
+}
+
+// over budget categories give back what can be rebuilt, generated chunks are never dropped
+void Model::CheckMemoryBudgets() {
+	m_over_budget = 0;
+	m_budget_check_turn = m_turn;
+	auto &budgets = m_config.memory_budget_kb;
+	if(std::all_of(budgets.begin(), budgets.end(), [](int b) { return b <= 0; })) return;
+	
+	MemoryStats stats = GetMemoryStats();
+	for(int i = 0; i < MemoryStats::num_categories; i++) {
+		auto category = MemoryStats::Category(i);
+		size_t budget = size_t(std::max(budgets[i], 0)) * 1024;
+		if(budget == 0 || stats.bytes[i] <= budget) continue;
+		trimMemory(category);
+		stats = GetMemoryStats();
+		if(stats.bytes[i] > budget) {
+			m_over_budget |= 1u << i;
+		}
+	}
+}
+
+bool Model::IsOverBudget(MemoryStats::Category category) const {
+	return (m_over_budget >> category) & 1;
+}
+
+void Model::trimMemory(MemoryStats::Category category) {
+	switch(category) {
+		case MemoryStats::chunk_tiles:
+		case MemoryStats::chunk_meta:
+			// chunks made only by looking at map, they come back empty when needed; loaded
+			// games put actors, items and explored bits into chunks not generated yet, those stay
+			for(auto it = m_chunks.begin(); it != m_chunks.end(); ) {
+				if(!it->second.generated && !IsActiveChunk(it->first) && it->second.IsBlank()) {
+					it = m_chunks.erase(it);
+				} else {
+					if(!it->second.dormant) {
+						it->second.dormant_actors.shrink_to_fit();
+						it->second.dormant_inventories.shrink_to_fit();
+						it->second.dormant_items.shrink_to_fit();
+					}
+					it++;
+				}
+			}
+			break;
+		case MemoryStats::objects:
+			m_free_objects.clear();
+			m_free_objects.shrink_to_fit();
+			m_actors.ShrinkToFit();
+			break;
+		case MemoryStats::inventories:
+			m_actors.ShrinkToFit();
+			break;
+		default:
+			break; // nothing to give back, only flagged
+	}
+}
+
+// every tile change after generation must go through here to keep summaries valid
+void Model::SetTile(const glm::ivec2& pos, Tile::Type type, Object* obj, uint32_t actor) {
+	glm::ivec2 chunk_pos, lpos;
+	SplitPosition(pos, chunk_pos, lpos);
+	Chunk& chunk = GetChunk(chunk_pos);
+	Tile& tile = chunk.TileAt(lpos);
+	Tile::Type old_type = tile.type;
+	tile.type = type;
+	tile.obj = obj;
+	tile.actor = actor;
+	chunk.version++;
+	chunk.UpdatePlanes(lpos);
+	
+	if(!chunk.generated) return; // summaries are built once chunk gets generated
+	
+	bool rebuild = terrain(old_type) != terrain(type);
+	if(rebuild) {
+		chunk.terrain_version = ++m_terrain_version;
+	}
+	int actors = (int)is_actor(type) - (int)is_actor(old_type);
+	for(int level = 0; level < Chunk::lod_levels; level++) {
+		glm::ivec2 cell = lpos / Chunk::lod_scale[level];
+		if(rebuild) {
+			chunk.UpdateSummary(level, cell);
+		} else {
+			chunk.SummaryAt(level, cell).actors += actors;
+		}
+	}
+}
+
+// recompute one summary cell from its tiles
+void Model::Chunk::UpdateSummary(int level, const glm::ivec2& cell) {
+	int scale = lod_scale[level];
+	std::array<int, Tile::Type::num_types> counts{};
+	int elevation = 0;
+	int actors = 0;
+	for(int y = cell.y*scale; y < (cell.y+1)*scale; y++) {
+		for(int x = cell.x*scale; x < (cell.x+1)*scale; x++) {
+			auto &t = tiles[y*xsize + x];
+			counts[terrain(t.type)]++;
+			elevation += t.elevation;
+			actors += is_actor(t.type);
+		}
+	}
+	auto &summary = SummaryAt(level, cell);
+	summary.type = std::max_element(counts.begin(), counts.end()) - counts.begin();
+	summary.elevation = (int)std::round((float)elevation / (scale*scale));
+	summary.actors = std::min(actors, 255);
+}
+
+void Model::Chunk::BuildSummaries() {
+	for(int level = 0; level < lod_levels; level++) {
+		int cells = xsize / lod_scale[level];
+		for(const auto &cell : VecIterate({0,0}, {cells,cells})) {
+			UpdateSummary(level, cell);
+		}
+	}
+}
+
+int BitPlane::Count(const glm::ivec2& from, const glm::ivec2& to) const {
+	int width = to.x - from.x;
+	if(width <= 0) return 0;
+	uint64_t mask = (width >= size ? ~uint64_t(0) : (uint64_t(1) << width) - 1) << from.x;
+	int count = 0;
+	for(int y = from.y; y < to.y; y++) {
+		count += __builtin_popcountll(rows[y] & mask);
+	}
+	return count;
+}
+
+void Model::Chunk::UpdatePlanes(const glm::ivec2& pos) {
+	Tile::Type type = TileAt(pos).type;
+	planes[walkable].Set(pos, IsWalkable(type));
+	planes[blocks_sight].Set(pos, in(type, {Tile::obstacle, Tile::tree, Tile::mountain}));
+	planes[water].Set(pos, type == Tile::water);
+	planes[actor].Set(pos, is_actor(type));
+	planes[item].Set(pos, type == Tile::item);
+}
+
+void Model::Chunk::BuildPlanes() {
+	for(const auto &pos : VecIterate({0,0}, {xsize,ysize})) {
+		UpdatePlanes(pos);
+	}
+}
+
+bool Model::Chunk::IsBlank() const {
+	if(!dormant_actors.empty() || !dormant_items.empty()) return false;
+	if(std::any_of(explored.rows.begin(), explored.rows.end(), [](uint64_t r) { return r != 0; })) return false;
+	return std::all_of(tiles.begin(), tiles.end(), [](const Tile& t) {
+		return t.type == Tile::empty && t.elevation == 0 && t.actor == 0 && t.obj == nullptr;
+	});
+}
+
+bool Model::TestPlane(Chunk::Plane plane, const glm::ivec2& pos) {
+	glm::ivec2 chunk_pos, lpos;
+	SplitPosition(pos, chunk_pos, lpos);
+	Chunk* chunk = FindChunk(chunk_pos);
+	return chunk && chunk->planes[plane].Test(lpos);
+}
+
+// popcount of world rectangle [from, to), split by chunks it overlaps
+int Model::CountPlane(Chunk::Plane plane, const glm::ivec2& from, const glm::ivec2& to) {
+	if(glm::any(glm::greaterThanEqual(from, to))) return 0;
+	glm::ivec2 first, last, lpos;
+	SplitPosition(from, first, lpos);
+	SplitPosition(to - 1, last, lpos);
+	int count = 0;
+	for(const auto &chunk_pos : VecIterate(first, last+1)) {
+		Chunk* chunk = FindChunk(chunk_pos);
+		if(!chunk) continue;
+		glm::ivec2 origin = chunk_pos * chunk_size;
+		glm::ivec2 a = glm::max(from - origin, glm::ivec2(0));
+		glm::ivec2 b = glm::min(to - origin, chunk_size);
+		count += chunk->planes[plane].Count(a, b);
+	}
+	return count;
+}
+
+// 8-neighborhood of pos, pos itself excluded
+int Model::CountNeighbors(Chunk::Plane plane, const glm::ivec2& pos) {
+	return CountPlane(plane, pos - 1, pos + 2) - TestPlane(plane, pos);
+}
+
+bool Model::IsFogEnabled() const {
+	return m_fov.GetRadius() > 0;
+}
+
+bool Model::IsVisible(const glm::ivec2& pos) const {
+	return !IsFogEnabled() || m_fov.IsVisible(pos - m_fov_origin);
+}
+
+bool Model::IsExplored(const glm::ivec2& pos) {
+	if(!IsFogEnabled()) return true;
+	glm::ivec2 chunk_pos, lpos;
+	SplitPosition(pos, chunk_pos, lpos);
+	Chunk* chunk = FindChunk(chunk_pos);
+	return chunk && chunk->explored.Test(lpos);
+}
+
+// plane rows are masked to window, only set bits are tested against field of view
+void Model::FindInSight(Chunk::Plane plane, int radius, std::vector<glm::ivec2>& found) {
+	found.clear();
+	if(!m_player_id) return;
+	bool fog = IsFogEnabled();
+	if(fog) radius = std::min(radius, m_fov.GetRadius());
+	glm::ivec2 player = GetPlayerPosition();
+	glm::ivec2 from = player - radius, to = player + radius + 1;
+	glm::ivec2 first, last, lpos;
+	SplitPosition(from, first, lpos);
+	SplitPosition(to - 1, last, lpos);
+	for(const auto &chunk_pos : VecIterate(first, last+1)) {
+		Chunk* chunk = FindChunk(chunk_pos);
+		if(!chunk) continue;
+		glm::ivec2 origin = chunk_pos * chunk_size;
+		glm::ivec2 a = glm::max(from - origin, glm::ivec2(0));
+		glm::ivec2 b = glm::min(to - origin, chunk_size);
+		int width = b.x - a.x;
+		uint64_t mask = (width >= BitPlane::size ? ~uint64_t(0) : (uint64_t(1) << width) - 1) << a.x;
+		for(int y = a.y; y < b.y; y++) {
+			for(uint64_t bits = chunk->planes[plane].rows[y] & mask; bits; bits &= bits - 1) {
+				glm::ivec2 pos = origin + glm::ivec2(__builtin_ctzll(bits), y);
+				if(!fog || m_fov.IsVisible(pos - m_fov_origin)) found.push_back(pos);
+			}
+		}
+	}
+}
+
+// fov window is narrower than chunk, so its rows span at most 2x2 chunks
+void Model::UpdateFieldOfView() {
+	if(!IsFogEnabled() || !m_player_id) return;
+	int size = m_fov.GetSize();
+	glm::ivec2 origin = GetPlayerPosition() - m_fov.GetRadius();
+	if(origin == m_fov_origin && m_fov_terrain_version == m_terrain_version) return;
+	m_fov_origin = origin;
+	m_fov_terrain_version = m_terrain_version;
+	
+	glm::ivec2 first_chunk, lpos, last_chunk, last_lpos;
+	SplitPosition(origin, first_chunk, lpos);
+	SplitPosition(origin + size - 1, last_chunk, last_lpos);
+	Chunk* chunks[2][2];
+	for(int y = 0; y < 2; y++) {
+		for(int x = 0; x < 2; x++) {
+			Chunk* chunk = FindChunk(first_chunk + glm::ivec2(x,y));
+			chunks[y][x] = chunk && chunk->generated ? chunk : nullptr;
+		}
+	}
+	bool two_columns = last_chunk.x != first_chunk.x;
+	uint64_t row_mask = (uint64_t(1) << size) - 1;
+	
+	// gather opaque rows, not generated terrain blocks sight
+	auto &opaque = m_fov.OpaqueRows();
+	for(int y = 0; y < size; y++) {
+		int cy = (lpos.y + y) / Chunk::ysize;
+		int ly = (lpos.y + y) % Chunk::ysize;
+		Chunk* left = chunks[cy][0];
+		Chunk* right = chunks[cy][1];
+		uint64_t row = left ? left->planes[Chunk::blocks_sight].rows[ly] >> lpos.x : ~uint64_t(0);
+		if(two_columns) {
+			row |= (right ? right->planes[Chunk::blocks_sight].rows[ly] : ~uint64_t(0)) << (Chunk::xsize - lpos.x);
+		}
+		opaque[y] = row & row_mask;
+	}
+	
+	m_fov.Compute();
+	
+	// remember what is seen
+	auto &visible = m_fov.VisibleRows();
+	for(int y = 0; y < size; y++) {
+		int cy = (lpos.y + y) / Chunk::ysize;
+		int ly = (lpos.y + y) % Chunk::ysize;
+		if(chunks[cy][0]) {
+			chunks[cy][0]->explored.rows[ly] |= visible[y] << lpos.x;
+		}
+		if(two_columns && chunks[cy][1]) {
+			chunks[cy][1]->explored.rows[ly] |= visible[y] >> (Chunk::xsize - lpos.x);
+		}
+	}
+}
+
+void Model::NextTurn() {
+	m_turn++;
+}
+
+uint32_t Model::GetTurn() const {
+	return m_turn;
+}
+
+bool Model::IsActiveChunk(const glm::ivec2& chunk_pos) const {
+	if(!m_active_valid) return true;
+	glm::ivec2 d = glm::abs(chunk_pos - m_active_center);
+	return std::max(d.x, d.y) <= m_config.sim_radius;
+}
+
+// region moves only when player enters another chunk, then just its border chunks change state
+void Model::UpdateActiveRegion() {
+	if(!m_player_id) return;
+	glm::ivec2 center, lpos;
+	SplitPosition(GetPlayerPosition(), center, lpos);
+	if(m_active_valid && center == m_active_center) {
+		// stats walk every chunk and actor, so not each turn
+		if(m_turn - m_budget_check_turn >= budget_check_turns) CheckMemoryBudgets();
+		return;
+	}
+	
+	bool full = !m_active_valid;
+	glm::ivec2 old_center = m_active_center;
+	m_active_center = center;
+	m_active_valid = true;
+	if(full) {
+		for(auto &it : m_chunks) {
+			updateChunkActivity(it.first, it.second);
+		}
+	} else {
+		int r = m_config.sim_radius;
+		for(auto c : {old_center, center}) {
+			for(const auto &pos : VecIterate(c - r, c + r + 1)) {
+				Chunk* chunk = FindChunk(pos);
+				if(chunk) updateChunkActivity(pos, *chunk);
+			}
+		}
+	}
+	CheckMemoryBudgets();
+}
+
+void Model::updateChunkActivity(const glm::ivec2& pos, Chunk& chunk) {
+	bool active = IsActiveChunk(pos);
+	if(!active && !chunk.dormant) {
+		sleepChunk(pos, chunk);
+	} else if(active && chunk.dormant && chunk.generated) {
+		wakeChunk(pos, chunk);
+	}
+}
+
+// turn actors and items of chunk into compact records, found through actor and item planes
+void Model::sleepChunk(const glm::ivec2& pos, Chunk& chunk) {
+	chunk.dormant = true;
+	chunk.dormant_since = m_turn;
+	glm::ivec2 origin = pos * chunk_size;
+	for(int y = 0; y < Chunk::ysize; y++) {
+		uint64_t bits = chunk.planes[Chunk::actor].rows[y] | chunk.planes[Chunk::item].rows[y];
+		while(bits) {
+			glm::ivec2 lpos(__builtin_ctzll(bits), y);
+			bits &= bits - 1;
+			Tile& tile = chunk.TileAt(lpos);
+			uint16_t local = lpos.y*Chunk::xsize + lpos.x;
+			ActorStore::Slot slot = m_actors.Find(tile.actor);
+			if(tile.type == Tile::enemy && slot != ActorStore::invalid) {
+				sleepActor(chunk, local, slot);
+			} else if(tile.type == Tile::item && tile.obj) {
+				chunk.dormant_items.push_back({local, (int16_t)static_cast<ItemObject*>(tile.obj)->item.idx});
+				RemoveObject(tile.obj);
+			} else {
+				continue; // player
+			}
+			SetTile(origin + lpos, Tile::empty, 0);
+		}
+	}
+}
+
+// actor with its whole inventory leaves store for a record of chunk, tile is left to caller
+void Model::sleepActor(Chunk& chunk, uint16_t local, ActorStore::Slot slot) {
+	auto &stats = m_actors.stats[slot];
+	auto &items = m_actors.items[slot];
+	chunk.dormant_inventories.insert(chunk.dormant_inventories.end(), items.begin(), items.end());
+	chunk.dormant_actors.push_back({local, (int16_t)stats.hp, (int16_t)stats.armor, (int16_t)stats.damage,
+		(uint16_t)items.Size(), (int16_t)stats.speed, m_actors.id[slot]});
+	m_actors.Remove(slot);
+}
+
+// recreate actors and items, actors catch up with time spent dormant by random displacement,
+// records without free tile around stay and try again on next wake up
+void Model::wakeChunk(const glm::ivec2& pos, Chunk& chunk) {
+	chunk.dormant = false;
+	glm::ivec2 origin = pos * chunk_size;
+	auto is_free = [&](glm::ivec2 lpos) {
+		return chunk.planes[Chunk::walkable].Test(lpos) && !chunk.planes[Chunk::actor].Test(lpos) && !chunk.planes[Chunk::item].Test(lpos);
+	};
+	
+	size_t kept = 0;
+	for(auto &d : chunk.dormant_items) {
+		glm::ivec2 lpos = Chunk::LocalPosition(d.local);
+		if(!is_free(lpos)) {
+			chunk.dormant_items[kept++] = d;
+			continue;
+		}
+		auto item = NewItemObject(Item{d.idx, false}, origin + lpos);
+		SetTile(item->position, Tile::item, item);
+	}
+	// capacity is kept, so chunks on edge of active region sleep again without allocating
+	chunk.dormant_items.resize(kept);
+	
+	// random walk moves 4 of 5 turns, that is variance of 0.4 per axis per turn
+	uint32_t elapsed = m_turn - chunk.dormant_since;
+	std::default_random_engine re(hash_random(m_seed, pos.x, pos.y ^ m_turn));
+	std::normal_distribution<float> spread(0.0f, std::sqrt(0.4f * std::max<uint32_t>(elapsed, 1)));
+	kept = 0;
+	size_t items = 0, kept_items = 0;
+	for(auto &d : chunk.dormant_actors) {
+		auto first = chunk.dormant_inventories.begin() + items;
+		items += d.items;
+		glm::ivec2 home = Chunk::LocalPosition(d.local);
+		glm::ivec2 lpos = home;
+		if(elapsed > 0) {
+			glm::ivec2 offset(std::lround(spread(re)), std::lround(spread(re)));
+			lpos = glm::clamp(home + offset, glm::ivec2(0), chunk_size - 1);
+		}
+		// landed in wall or on someone, look around old position
+		for(int r = 0; r <= 2 && !is_free(lpos); r++) {
+			for(const auto &p : VecIterate(glm::max(home - r, glm::ivec2(0)), glm::min(home + r + 1, chunk_size))) {
+				if(is_free(p)) {
+					lpos = p;
+					break;
+				}
+			}
+		}
+		if(!is_free(lpos)) {
+			chunk.dormant_actors[kept++] = d;
+			std::copy(first, first + d.items, chunk.dormant_inventories.begin() + kept_items);
+			kept_items += d.items;
+			continue;
+		}
+		
+		ActorStore::Slot slot = InsertActor(d.id, origin + lpos, {d.hp, d.armor, d.damage, d.speed});
+		for(auto it = first; it != first + d.items; it++) {
+			m_actors.items[slot].Push(*it);
+		}
+	}
+	chunk.dormant_actors.resize(kept);
+	chunk.dormant_inventories.resize(kept_items);
+}
+
+// speed is clamped so that delay always fits into scheduler wheel
+uint32_t Model::ActionDelay(int speed) {
+	speed = glm::clamp(speed, 40, 1000);
+	return ActorStats::normal_speed * ActorStats::normal_speed / speed;
+}
+
+uint32_t Model::GetTime() const {
+	return m_scheduler.GetTime();
+}
+
+void Model::ScheduleActor(ActorStore::Slot slot) {
+	m_actors.next_action[slot] = m_scheduler.GetTime() + ActionDelay(m_actors.stats[slot].speed);
+	m_scheduler.Schedule(m_actors.id[slot], m_actors.next_action[slot]);
+}
+
+// entries of removed, dormant or rescheduled actors are skipped
+bool Model::PopDueActors(uint32_t until, std::vector<uint32_t>& ids) {
+	ids.clear();
+	uint32_t time;
+	while(ids.empty() && m_scheduler.PopDueTick(until, m_due_ids, time)) {
+		for(uint32_t id : m_due_ids) {
+			ActorStore::Slot slot = m_actors.Find(id);
+			if(slot != ActorStore::invalid && m_actors.next_action[slot] == time) {
+				ids.push_back(id);
+			}
+		}
+	}
+	return !ids.empty();
+}
+
+uint32_t Model::newObjectId() {
+	return ++m_last_object_id;
+}
+
+// enemy placed on free tile, id 0 gets new id
+ActorStore::Slot Model::InsertActor(uint32_t id, glm::ivec2 pos, const ActorStats& stats) {
+	if(id == 0) {
+		id = newObjectId();
+	}
+	ActorStore::Slot slot = m_actors.Add(id, pos, stats);
+	SetTile(pos, Tile::enemy, nullptr, id);
+	ScheduleActor(slot);
+	return slot;
+}
+
+ActorStore& Model::GetActors() {
+	return m_actors;
+}
+
+// tile must be cleared by caller, like with RemoveObject
+void Model::RemoveActor(uint32_t id) {
+	ActorStore::Slot slot = m_actors.Find(id);
+	if(slot != ActorStore::invalid) {
+		m_actors.Remove(slot);
+	}
+}
+
+uint32_t Model::GetPlayerId() const {
+	return m_player_id;
+}
+
+ActorStore::Slot Model::GetPlayerSlot() const {
+	return m_actors.Find(m_player_id);
+}
+
 void Model::RemoveObject(Object* obj) {
-	std::unique_ptr<Object> pobj(obj);
-	auto it = m_objects.find(pobj);
-	if(it != m_objects.end()) (*it)->type = Object::none;
-	pobj.release(); // don't free
+	auto it = m_objects.find(obj);
+	if(it == m_objects.end()) return;
+	// loop in ForEachObject erases it, otherwise it goes right away
+	if(m_iterating) {
+		(*it)->type = Object::none;
+	} else {
+		m_free_objects.push_back(m_objects.extract(it));
+	}
 }
 
-void Model::InsertObject(Object* pos) {
-	m_objects.insert(std::unique_ptr<Object>(pos));
+void Model::InsertObject(Object* obj) {
+	if(obj->id == 0) {
+		obj->id = newObjectId();
+	} else {
+		m_last_object_id = std::max(m_last_object_id, obj->id);
+	}
+	m_objects.insert(std::unique_ptr<Object>(obj));
+	// every node may end up free, making room now keeps removals allocation free
+	size_t nodes = m_objects.size() + m_free_objects.size();
+	if(m_free_objects.capacity() < nodes) {
+		m_free_objects.reserve(2 * nodes);
+	}
+}
+
+// turns with drops, pickups and chunk wake ups don't allocate once there are enough free nodes
+ItemObject* Model::NewItemObject(Item item, glm::ivec2 pos, uint32_t id) {
+	if(m_free_objects.empty()) {
+		auto obj = new ItemObject(item, pos);
+		obj->id = id;
+		InsertObject(obj);
+		return obj;
+	}
+	auto node = std::move(m_free_objects.back());
+	m_free_objects.pop_back();
+	// every object in set is an item
+	auto obj = static_cast<ItemObject*>(node.value().get());
+	*obj = ItemObject(item, pos);
+	if(id == 0) {
+		obj->id = newObjectId();
+	} else {
+		obj->id = id;
+		m_last_object_id = std::max(m_last_object_id, id);
+	}
+	m_objects.insert(std::move(node));
+	return obj;
 }
 
 void Model::ForEachObject(std::function<void(Object*)> func) {
+	bool iterating = m_iterating;
+	m_iterating = true;
 	for(auto it = m_objects.begin(); it != m_objects.end(); ) {
 		if((*it)->type != Object::none) {
 			func(it->get());
 			it++;
 		} else {
-			it = m_objects.erase(it);
+			m_free_objects.push_back(m_objects.extract(it++));
 		}
 	}
+	m_iterating = iterating;
 }
 
 
 void Model::ClearMap() {
 	m_chunks.clear();
 	m_objects.clear();
+	m_free_objects.clear();
+	m_effects.clear();
+	m_terrain_version++;
 	m_generated_chunks.clear();
+	m_objects_generated_chunks.clear();
+	m_active_valid = false;
+	m_actors.Clear();
+	m_player_id = 0;
+	m_last_object_id = 0;
+	m_scheduler.Clear();
 }
 
 void Model::NewGame() {
 	// put player on map
 	glm::ivec2 playerPos = {0*Chunk::xsize, 0*Chunk::ysize};
-	m_player = std::make_unique<Actor>(playerPos);
-	auto &plpos = GetTileAt(playerPos);
-	plpos.type = Tile::Type::friendly;
-	plpos.obj = m_player.get();
-	m_player->hp = 100;
-	m_player->armor = 10;
-	m_player->damage = 40;
+	m_turn = 0;
+	m_player_id = newObjectId();
+	ActorStore::Slot slot = m_actors.Add(m_player_id, playerPos, {100, 10, 40, ActorStats::normal_speed});
+	SetTile(playerPos, Tile::Type::friendly, nullptr, m_player_id);
 	
 	// starting items
-	m_player->items = {
+	m_actors.items[slot] = {
 		{0},{1}
 	};
 }
@@ -85,6 +713,8 @@ const glm::ivec2 Model::chunk_size = {Model::Chunk::xsize, Model::Chunk::ysize};
 
 void Model::GenerateChunk(glm::ivec2 tl_chunk) {
 	if(m_generated_chunks.find(tl_chunk) != m_generated_chunks.end()) return;
+	PROFILE_SCOPE(m_profiler, Profiler::generation);
+	TRACE_SCOPE("GenerateChunk");
 	m_generated_chunks.insert(tl_chunk);
 	std::default_random_engine re;
 	std::uniform_int_distribution<int> object_unif(0,1000);
@@ -125,46 +755,87 @@ void Model::GenerateChunk(glm::ivec2 tl_chunk) {
 		// enemies
 		if( gen_enemies && o.type == Tile::empty && object_unif(re) < 8 ) {
 			if(object_unif(re) < 700) { // 7/10 chance place enemy
-				auto en = std::make_unique<Actor>(pos);
+				// one in ten is fast and one in ten slow, rolled from position
+				// because next draws of per tile seeded engine follow the spawn rolls
+				uint32_t speed_roll = (uint32_t(pos.x) * 73856093u ^ uint32_t(pos.y) * 19349663u) % 10; // unsigned, wraps
+				int speed = speed_roll == 0 ? 150 : speed_roll == 1 ? 50 : ActorStats::normal_speed;
+				uint32_t id = newObjectId();
+				ActorStore::Slot slot = m_actors.Add(id, pos, {50, 0, 10, speed});
 				o.type = Tile::enemy;
-				o.obj = en.get();
-				en->hp = 50;
-				en->damage = 10;
+				o.obj = nullptr;
+				o.actor = id;
 				// 9/10 enemies drop item
 				if(object_unif(re) < 900) {
-					en->items = {
+					m_actors.items[slot] = {
 						{item_unif(re),false}
 					};
 				}
-				m_objects.insert(std::move(en));
+				ScheduleActor(slot);
 			} else { // 3/10 chance place item
 				Item item;
 				item.idx = item_unif(re);
-				auto en = std::make_unique<ItemObject>(item, pos);
 				o.type = Tile::item;
-				o.obj = en.get();
-				m_objects.insert(std::move(en));
+				o.obj = NewItemObject(item, pos);
 			}
 		}
 	}
+	
+	auto &chunk = GetChunk(tl_chunk);
+	chunk.generated = true;
+	chunk.version++;
+	chunk.terrain_version = ++m_terrain_version;
+	chunk.BuildSummaries();
+	chunk.BuildPlanes();
+	// room for twice the generated population (at least 32, chasers follow player from
+	// chunk to chunk), so chunk goes to sleep without allocating unless actors crowd into it
+	int population = chunk.planes[Chunk::actor].Count(glm::ivec2(0), chunk_size);
+	chunk.dormant_actors.reserve(std::max(2 * population, 32));
+	chunk.dormant_inventories.reserve(std::max(2 * population, 32));
+	chunk.dormant_items.reserve(2 * chunk.planes[Chunk::item].Count(glm::ivec2(0), chunk_size));
+	updateChunkActivity(tl_chunk, chunk);
 }
 
 
 
-glm::ivec2 Model::GetAttackedPos() {
-	return m_attacked_pos;
+// effects play one after another, starting after the last queued one ends
+void Model::QueueEffect(Effect::Type type, glm::ivec2 pos, std::chrono::milliseconds duration) {
+	static const std::chrono::milliseconds max_delay(1000);
+	static const size_t max_effects = 64;
+	
+	auto now = Effect::clock::now();
+	m_effects.reserve(max_effects); // once, queue never grows past it
+	m_effects.erase(std::remove_if(m_effects.begin(), m_effects.end(), [&](const Effect& e) {
+		return e.end <= now;
+	}), m_effects.end());
+	if(m_effects.size() >= max_effects) {
+		m_effects.erase(m_effects.begin());
+	}
+	
+	auto start = m_effects.empty() ? now : std::min(m_effects.back().end, now + max_delay);
+	m_effects.push_back(Effect{type, pos, start, start + duration});
 }
 
-void Model::SetAttackedPos(glm::ivec2 pos) {
-	m_attacked_pos = pos;
+const std::vector<Effect>& Model::GetEffects() const {
+	return m_effects;
 }
 
-Actor* Model::GetPlayer() {
-	return m_player.get();
+// time when some effect starts or ends, so view knows when to redraw
+Effect::clock::time_point Model::GetNextEffectChange(Effect::clock::time_point now) const {
+	auto next = Effect::clock::time_point::max();
+	for(auto &e : m_effects) {
+		if(e.start > now) {
+			next = std::min(next, e.start);
+		} else if(e.end > now) {
+			next = std::min(next, e.end);
+		}
+	}
+	return next;
 }
 
 glm::ivec2 Model::GetPlayerPosition() {
-	return m_player->position;
+	// no player before first game starts
+	ActorStore::Slot slot = GetPlayerSlot();
+	return slot != ActorStore::invalid ? m_actors.position[slot] : glm::ivec2(0,0);
 }
 
 
@@ -181,97 +852,181 @@ static glm::ivec2 j2v(const nlohmann::json& v) {
 	return {v[0], v[1]};
 }
 	
-static nlohmann::json ObjectToJson(Object* object) {
+static nlohmann::json ItemObjectToJson(ItemObject* object) {
 	using namespace nlohmann;
 	json jobject;
 	jobject["type"] = object->type;
 	jobject["position"] = v2j(object->position);
-	if(object->type == Object::Type::item) {
-		jobject["idx"] = static_cast<ItemObject*>(object)->item.idx;
-	} else {
-		Actor* actor = static_cast<Actor*>(object);
-		
-		jobject["hp"] = actor->hp;
-		jobject["armor"] = actor->armor;
-		jobject["damage"] = actor->damage;
-		
-		jobject["items"] = json::array();
-		
-		for(auto& i : actor->items) {
-			json jitem = json::array({i.idx, i.equipped});
-			jobject["items"].push_back(jitem);
-		}
-	}
+	jobject["id"] = object->id;
+	jobject["idx"] = object->item.idx;
 	return jobject;
 }
 
-static Object* JsonToObject(nlohmann::json j) {
+static nlohmann::json ActorToJson(uint32_t id, glm::ivec2 position, const ActorStats& stats, const Inventory& items) {
 	using namespace nlohmann;
-	json jactor;
-	Object* object;
-	if(j["type"] == Object::Type::item) {
-		Item item;
-		item.idx = j["idx"];
-		ItemObject* itemobj = new ItemObject(item, j2v(j["position"]));
-		object = itemobj;
-	} else {
-		Actor* actor = new Actor(j2v(j["position"]));
-		object = actor;
-		actor->hp 		= j["hp"];
-		actor->armor 	= j["armor"];
-		actor->damage 	= j["damage"];
-		
-		for(auto& i : j["items"]) {
-			actor->items.push_back(Item{i[0], i[1]});
-		}
+	json jobject;
+	jobject["type"] = Object::Type::actor;
+	jobject["position"] = v2j(position);
+	jobject["id"] = id;
+	
+	jobject["hp"] = stats.hp;
+	jobject["armor"] = stats.armor;
+	jobject["damage"] = stats.damage;
+	jobject["speed"] = stats.speed;
+	
+	jobject["items"] = json::array();
+	
+	for(auto& i : items) {
+		json jitem = json::array({i.idx, i.equipped});
+		jobject["items"].push_back(jitem);
 	}
+	return jobject;
+}
+
+static nlohmann::json ActorToJson(const ActorStore& actors, ActorStore::Slot slot) {
+	return ActorToJson(actors.id[slot], actors.position[slot], actors.stats[slot], actors.items[slot]);
+}
+
+static ItemObject* JsonToItemObject(const nlohmann::json& j) {
+	Item item;
+	item.idx = j["idx"];
+	ItemObject* object = new ItemObject(item, j2v(j["position"]));
+	object->id = j.value("id", 0u);
 	return object;
 }
 
+static ActorStore::Slot JsonToActor(const nlohmann::json& j, ActorStore& actors, uint32_t id, const std::vector<ItemDef>& defs) {
+	ActorStats stats;
+	stats.hp 		= j["hp"];
+	stats.armor 	= j["armor"];
+	stats.damage 	= j["damage"];
+	stats.speed 	= j.value("speed", ActorStats::normal_speed);
+	ActorStore::Slot slot = actors.Add(id, j2v(j["position"]), stats);
+	
+	for(auto& i : j["items"]) {
+		Item item{i[0], i[1]};
+		actors.items[slot].Push(item, defs[item.idx].slot);
+	}
+	return slot;
+}
+
 void Model::SaveGame(std::string jsonFilename) {
+	TRACE_SCOPE("SaveGame");
 	using namespace nlohmann;
 	json j;
 	
-	j["player"] = ObjectToJson(m_player.get());
+	j["player"] = ActorToJson(m_actors, GetPlayerSlot());
 	json jobjects = json::array();
+	for(ActorStore::Slot slot = 0; slot < m_actors.Size(); slot++) {
+		if(m_actors.id[slot] != m_player_id) {
+			jobjects.push_back(ActorToJson(m_actors, slot));
+		}
+	}
 	ForEachObject([&](Object* o) {
-		jobjects.push_back(ObjectToJson(o));
+		jobjects.push_back(ItemObjectToJson(static_cast<ItemObject*>(o)));
 	});
+	// dormant records are saved as regular objects, they fall asleep again after load
+	for(auto &it : m_chunks) {
+		glm::ivec2 origin = it.first * chunk_size;
+		auto item = it.second.dormant_inventories.begin();
+		for(auto &d : it.second.dormant_actors) {
+			Inventory items;
+			for(auto end = item + d.items; item != end; item++) {
+				items.Push(*item);
+			}
+			jobjects.push_back(ActorToJson(d.id, origin + Chunk::LocalPosition(d.local), {d.hp, d.armor, d.damage, d.speed}, items));
+		}
+		for(auto &d : it.second.dormant_items) {
+			ItemObject item(Item{d.idx, false}, origin + Chunk::LocalPosition(d.local));
+			jobjects.push_back(ItemObjectToJson(&item));
+		}
+	}
 	j["m_objects"] = jobjects;
 	j["seed"] = m_seed;
+	j["turn"] = m_turn;
 	j["camera_position"] = v2j(m_camera_position);
 	j["m_generated_chunks"] = json::array();
 	m_objects_generated_chunks.insert(m_generated_chunks.begin(), m_generated_chunks.end());
 	for(auto &ch : m_objects_generated_chunks) {
 		j["m_generated_chunks"].push_back(v2j(ch));
 	}
+	
+	// explored masks, 64 words per chunk
+	j["explored"] = json::array();
+	for(auto &it : m_chunks) {
+		auto &rows = it.second.explored.rows;
+		if(std::all_of(rows.begin(), rows.end(), [](uint64_t r) { return r == 0; })) continue;
+		j["explored"].push_back({{"chunk", v2j(it.first)}, {"rows", rows}});
+	}
 	std::ofstream f(jsonFilename);
 	f.width(4);
 	f << j;
 }
 
 void Model::LoadGame(std::string jsonFilename) {
+	TRACE_SCOPE("LoadGame");
 	using namespace nlohmann;
 	std::ifstream f(jsonFilename);
 	json j;
 	f >> j;
 	m_seed = j["seed"];
+	m_turn = j.value("turn", 0u);
 	m_camera_position = j2v(j["camera_position"]);
+	// ids of all saved objects are known before any missing one is assigned
 	for(auto &e : j["m_objects"]) {
-		auto en = std::unique_ptr<Object>(JsonToObject(e));
-		auto &plpos = GetTileAt(en->position);
-		plpos.type = en->type == Object::actor ? Tile::Type::enemy : Tile::item;
-		plpos.obj = en.get();
-		m_objects.insert(std::move(en));
+		m_last_object_id = std::max(m_last_object_id, e.value("id", 0u));
+	}
+	m_last_object_id = std::max(m_last_object_id, j["player"].value("id", 0u));
+	// dormant records that found no room on wake up share tile with someone, they become records again
+	glm::ivec2 player_pos = j2v(j["player"]["position"]);
+	auto occupied = [&](glm::ivec2 pos) {
+		return pos == player_pos || TestPlane(Chunk::actor, pos) || TestPlane(Chunk::item, pos);
+	};
+	for(auto &e : j["m_objects"]) {
+		glm::ivec2 pos = j2v(e["position"]), chunk_pos, lpos;
+		SplitPosition(pos, chunk_pos, lpos);
+		uint16_t local = lpos.y*Chunk::xsize + lpos.x;
+		if(e["type"] == Object::Type::item) {
+			ItemObject* item = JsonToItemObject(e);
+			if(occupied(pos)) {
+				GetChunk(chunk_pos).dormant_items.push_back({local, (int16_t)item->item.idx});
+				delete item;
+				continue;
+			}
+			SetTile(item->position, Tile::item, item);
+			InsertObject(item);
+		} else {
+			uint32_t id = e.value("id", 0u);
+			ActorStore::Slot slot = JsonToActor(e, m_actors, id ? id : newObjectId(), m_item_defs);
+			if(occupied(pos)) {
+				sleepActor(GetChunk(chunk_pos), local, slot);
+				continue;
+			}
+			SetTile(m_actors.position[slot], Tile::enemy, nullptr, m_actors.id[slot]);
+			ScheduleActor(slot);
+		}
 	}
 	auto gen_chunks = j["m_generated_chunks"];
 	for(auto &ch : gen_chunks) {
 		m_objects_generated_chunks.insert(j2v(ch));
 	}
-	m_player = std::unique_ptr<Actor>(static_cast<Actor*>(JsonToObject(j["player"])));
-	auto &plpos = GetTileAt(m_player->position);
-	plpos.type = Tile::Type::friendly;
-	plpos.obj = m_player.get();
+	auto explored = j.find("explored");
+	if(explored != j.end()) {
+		for(auto &e : *explored) {
+			auto &rows = GetChunk(j2v(e["chunk"])).explored.rows;
+			for(int y = 0; y < BitPlane::size; y++) {
+				rows[y] = e["rows"][y].get<uint64_t>();
+			}
+		}
+	}
+	uint32_t player_id = j["player"].value("id", 0u);
+	ActorStore::Slot slot = JsonToActor(j["player"], m_actors, player_id ? player_id : newObjectId(), m_item_defs);
+	m_player_id = m_actors.id[slot];
+	SetTile(m_actors.position[slot], Tile::Type::friendly, nullptr, m_player_id);
+}
+
+uint32_t Model::GetSeed() const {
+	return m_seed;
 }
 
 void Model::SetSeed(std::string seed) {
@@ -281,6 +1036,114 @@ void Model::SetSeed(std::string seed) {
 	m_seed = seeds.front();
 }
 
+void Model::SetSeed(uint32_t seed) {
+	m_seed = seed;
+}
+
+static uint64_t hash_combine(uint64_t h, uint64_t v) {
+	return (h ^ hash_random(uint32_t(v >> 32), uint32_t(v), uint32_t(h))) * 0x100000001B3ull;
+}
+
+// order of actors in store and items in set may differ, so per object hashes are summed
+uint64_t Model::GetStateHash() {
+	uint64_t sum = 0;
+	for(ActorStore::Slot slot = 0; slot < m_actors.Size(); slot++) {
+		auto &stats = m_actors.stats[slot];
+		uint64_t h = hash_combine(m_actors.id[slot], uint32_t(m_actors.position[slot].x) | uint64_t(uint32_t(m_actors.position[slot].y)) << 32);
+		h = hash_combine(h, uint32_t(stats.hp) | uint64_t(uint32_t(stats.armor)) << 32);
+		h = hash_combine(h, uint32_t(stats.damage) | uint64_t(uint32_t(stats.speed)) << 32);
+		h = hash_combine(h, m_actors.next_action[slot]);
+		for(auto &item : m_actors.items[slot]) {
+			h = hash_combine(h, uint32_t(item.idx) | uint64_t(item.equipped) << 32);
+		}
+		sum += h;
+	}
+	for(auto &obj : m_objects) {
+		auto item = static_cast<ItemObject*>(obj.get());
+		sum += hash_combine(hash_combine(item->id, uint32_t(item->position.x) | uint64_t(uint32_t(item->position.y)) << 32), item->item.idx);
+	}
+	for(auto &it : m_chunks) {
+		uint64_t chunk = uint32_t(it.first.x) | uint64_t(uint32_t(it.first.y)) << 32;
+		auto item = it.second.dormant_inventories.begin();
+		for(auto &d : it.second.dormant_actors) {
+			uint64_t h = hash_combine(hash_combine(d.id, d.local), uint16_t(d.hp) | uint32_t(uint16_t(d.armor)) << 16);
+			h = hash_combine(h, uint16_t(d.damage) | uint32_t(uint16_t(d.speed)) << 16 | uint64_t(d.items) << 32);
+			for(auto end = item + d.items; item != end; item++) {
+				h = hash_combine(h, uint32_t(item->idx) | uint64_t(item->equipped) << 32);
+			}
+			sum += h;
+		}
+		for(auto &d : it.second.dormant_items) {
+			sum += hash_combine(hash_combine(chunk, d.local), uint16_t(d.idx));
+		}
+		// terrain and occupancy by bit-planes, then explored tiles
+		uint64_t h = chunk;
+		for(auto &plane : it.second.planes) {
+			for(uint64_t row : plane.rows) {
+				h = hash_combine(h, row);
+			}
+		}
+		for(uint64_t row : it.second.explored.rows) {
+			h = hash_combine(h, row);
+		}
+		sum += h;
+	}
+	uint64_t h = hash_combine(sum, m_turn);
+	h = hash_combine(h, m_scheduler.GetTime());
+	return hash_combine(h, m_actors.Size());
+}
+
+static uint64_t actor_hash(uint32_t id, glm::ivec2 pos, const ActorStats& stats) {
+	uint64_t h = hash_combine(id, uint32_t(pos.x) | uint64_t(uint32_t(pos.y)) << 32);
+	h = hash_combine(h, uint32_t(stats.hp) | uint64_t(uint32_t(stats.armor)) << 32);
+	return hash_combine(h, uint32_t(stats.damage) | uint64_t(uint32_t(stats.speed)) << 32);
+}
+
+static uint64_t item_hash(uint64_t h, Item item) {
+	return hash_combine(h, uint32_t(item.idx) | uint64_t(item.equipped) << 32);
+}
+
+// dormant records hash like actors and items they turn into when loaded, item ids
+// and scheduling are left out as dormant items get new ids and actors new turns
+uint64_t Model::GetWorldHash() {
+	uint64_t sum = 0;
+	for(ActorStore::Slot slot = 0; slot < m_actors.Size(); slot++) {
+		uint64_t h = actor_hash(m_actors.id[slot], m_actors.position[slot], m_actors.stats[slot]);
+		for(auto &item : m_actors.items[slot]) {
+			h = item_hash(h, item);
+		}
+		sum += h;
+	}
+	for(auto &obj : m_objects) {
+		if(obj->type == Object::none) continue;
+		// lying items keep only index, also in saves
+		Item item = {static_cast<ItemObject*>(obj.get())->item.idx, false};
+		sum += item_hash(uint32_t(obj->position.x) | uint64_t(uint32_t(obj->position.y)) << 32, item);
+	}
+	for(auto &it : m_chunks) {
+		glm::ivec2 origin = it.first * chunk_size;
+		auto item = it.second.dormant_inventories.begin();
+		for(auto &d : it.second.dormant_actors) {
+			uint64_t h = actor_hash(d.id, origin + Chunk::LocalPosition(d.local), {d.hp, d.armor, d.damage, d.speed});
+			for(auto end = item + d.items; item != end; item++) {
+				h = item_hash(h, *item);
+			}
+			sum += h;
+		}
+		for(auto &d : it.second.dormant_items) {
+			glm::ivec2 pos = origin + Chunk::LocalPosition(d.local);
+			sum += item_hash(uint32_t(pos.x) | uint64_t(uint32_t(pos.y)) << 32, Item{d.idx, false});
+		}
+		for(int y = 0; y < BitPlane::size; y++) {
+			if(it.second.explored.rows[y] == 0) continue;
+			sum += hash_combine(hash_combine(uint32_t(it.first.x) | uint64_t(uint32_t(it.first.y)) << 32, y), it.second.explored.rows[y]);
+		}
+	}
+	uint64_t h = hash_combine(sum, m_turn);
+	h = hash_combine(h, m_seed);
+	return hash_combine(h, m_player_id);
+}
+
 void Model::LoadConfig(std::string jsonFilename) {
 	using namespace nlohmann;
 	std::fstream f(jsonFilename);
@@ -298,6 +1161,28 @@ void Model::LoadConfig(std::string jsonFilename) {
 		return it != j.end() ? (decltype(def))*it : def;
 	};
 	
+	// load tunables
+	{
+		auto jconfig = j.find("config");
+		if(jconfig != j.end()) {
+			m_config.water_anim_ms = get(*jconfig, "water_anim_ms", m_config.water_anim_ms);
+			m_config.max_fps = get(*jconfig, "max_fps", m_config.max_fps);
+			m_config.hit_flash_ms = get(*jconfig, "hit_flash_ms", m_config.hit_flash_ms);
+			m_config.chase_radius = get(*jconfig, "chase_radius", m_config.chase_radius);
+			m_config.fov_radius = get(*jconfig, "fov_radius", m_config.fov_radius);
+			m_config.sim_radius = get(*jconfig, "sim_radius", m_config.sim_radius);
+			m_config.sim_threads = get(*jconfig, "sim_threads", m_config.sim_threads);
+			auto jbudgets = jconfig->find("memory_budget_kb");
+			if(jbudgets != jconfig->end()) {
+				for(int i = 0; i < MemoryStats::num_categories; i++) {
+					auto name = MemoryStats::GetName(MemoryStats::Category(i));
+					m_config.memory_budget_kb[i] = get(*jbudgets, name, m_config.memory_budget_kb[i]);
+				}
+			}
+		}
+	}
+	m_fov.SetRadius(m_config.fov_radius);
+	
 	// load item definitions
 	{
 		for(auto &i : j["items"]) {
@@ -309,6 +1194,8 @@ void Model::LoadConfig(std::string jsonFilename) {
 				get(i, "armor", 0),
 				get(i, "hp", 0),
 			});
+			auto &def = m_item_defs.back();
+			def.slot = def.consumable ? EquipSlot::none : def.damage ? EquipSlot::weapon : def.armor ? EquipSlot::armor : EquipSlot::trinket;
 		}
 	}
 }
@@ -321,6 +1208,10 @@ const std::array<char, 4>& Model::GetElevationMap() {
 	return m_elevation_map;
 }
 
+const Config& Model::GetConfig() const {
+	return m_config;
+}
+
 
 // ============= Menu ==============
 
@@ -401,6 +1292,36 @@ bool Model::PopView() {
 	return true;
 }
 
+// Zoom
+
+void Model::SetZoomLevel(int level) {
+	m_zoom_level = glm::clamp(level, 0, zoom_levels-1);
+}
+
+int Model::GetZoomLevel() const {
+	return m_zoom_level;
+}
+
+void Model::ToggleMinimap() {
+	m_minimap ^= true;
+}
+
+bool Model::IsMinimapShown() const {
+	return m_minimap;
+}
+
+Profiler& Model::GetProfiler() {
+	return m_profiler;
+}
+
+void Model::ToggleProfiler() {
+	m_profiler_shown ^= true;
+}
+
+bool Model::IsProfilerShown() const {
+	return m_profiler_shown;
+}
+
 // Selection
 
 void Model::IncrementSelection(int dir) {
@@ -8,10 +8,16 @@
 #include <set>
 
 #include "Utils.hpp"
+#include "FieldOfView.hpp"
+#include "Scheduler.hpp"
+#include "ActorStore.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
 #include <glm/glm.hpp>
 #include <glm/vector_relational.hpp>
 
 #include <functional>
+#include <chrono>
 
 struct Object {
 	enum Type {
@@ -19,11 +25,22 @@ struct Object {
 		item,
 		actor
 	};
-	Object(Type t=actor, glm::ivec2 pos={0,0}) : type(t), position(pos) {}
+	Object(Type t=actor, glm::ivec2 pos={0,0}) : type(t), position(pos), id(0) {}
+	virtual ~Object() = default; // set owns items through base pointer
 	Type type;
 	glm::ivec2 position;
+	uint32_t id; // stable across saves and dormancy, shared id space with actors
 };
 
+// owning set of objects that can be searched by raw pointer, without taking ownership
+struct ObjectLess {
+	using is_transparent = void;
+	bool operator()(const std::unique_ptr<Object>& a, const std::unique_ptr<Object>& b) const { return a.get() < b.get(); }
+	bool operator()(const Object* a, const std::unique_ptr<Object>& b) const { return a < b.get(); }
+	bool operator()(const std::unique_ptr<Object>& a, const Object* b) const { return a.get() < b; }
+};
+using ObjectSet = std::set<std::unique_ptr<Object>, ObjectLess>;
+
 struct ItemDef {
 	int charRepr;
 	std::string name;
@@ -31,19 +48,7 @@ struct ItemDef {
 	int damage;
 	int armor;
 	int hp;
-};
-
-struct Item {
-	int idx;
-	bool equipped;
-};
-
-struct Actor : Object {
-	Actor(glm::ivec2 pos) : Object(Object::Type::actor, pos) {}
-	int hp;
-	int armor;
-	int damage;
-	std::vector<Item> items;
+	EquipSlot slot; // derived from stats, consumables have none
 };
 
 struct ItemObject : Object {
@@ -54,8 +59,24 @@ struct ItemObject : Object {
 };
 
 
+// compact actor of a dormant chunk, it is not in actor store until chunk wakes up
+struct DormantActor {
+	uint16_t local;  // tile index inside chunk
+	int16_t  hp;
+	int16_t  armor;
+	int16_t  damage;
+	uint16_t items;  // count, they follow items of earlier records in chunk's dormant_inventories
+	int16_t  speed;
+	uint32_t id;
+};
+
+struct DormantItem {
+	uint16_t local;
+	int16_t  idx;
+};
+
 struct Tile {
-	enum Type {
+	enum Type : uint8_t {
 		empty,
 		friendly,
 		enemy,
@@ -67,8 +88,45 @@ struct Tile {
 		num_types
 	};
 	Type type;
-	int elevation;
-	Object* obj;
+	int8_t elevation;
+	uint32_t actor; // id of actor standing here, 0 for none
+	Object* obj;    // item lying here
+};
+
+// downsampled block of tiles, used by zoomed out views and minimap
+struct TileSummary {
+	uint8_t type;      // dominant terrain type (actors and items count as empty)
+	int8_t 	elevation; // mean elevation
+	uint8_t actors;    // number of actors inside block
+	uint8_t unused;
+};
+
+// one bit per tile of a chunk, row y is a single word with bit x for tile x
+struct BitPlane {
+	static constexpr int size = 64;
+	std::array<uint64_t, size> rows{};
+	
+	bool Test(const glm::ivec2& pos) const {
+		return (rows[pos.y] >> pos.x) & 1;
+	}
+	void Set(const glm::ivec2& pos, bool value) {
+		uint64_t bit = uint64_t(1) << pos.x;
+		rows[pos.y] = value ? rows[pos.y] | bit : rows[pos.y] & ~bit;
+	}
+	// number of set bits in local rectangle [from, to)
+	int Count(const glm::ivec2& from, const glm::ivec2& to) const;
+};
+
+// short visual effect (e.g. hit flash), game logic never waits for it
+struct Effect {
+	enum Type {
+		hit
+	};
+	using clock = std::chrono::steady_clock;
+	Type type;
+	glm::ivec2 position;
+	clock::time_point start;
+	clock::time_point end;
 };
 
 enum class ViewType {
@@ -94,6 +152,36 @@ struct MenuItem {
 	bool operator<(const MenuItem& b) const { return getWidth() < b.getWidth(); }
 };
 
+// live memory of model by category, in bytes (containers are counted by capacity)
+struct MemoryStats {
+	enum Category {
+		chunk_tiles,
+		chunk_meta, 	// bit-planes, dormant records, chunk map
+		objects, 		// items on map and actor store
+		inventories,
+		lod_fov, 		// lod summaries and field of view of model (view keeps its own caches, not counted)
+		generation, 	// sets of generated chunks (noise lives only while chunk is generated)
+		num_categories
+	};
+	size_t bytes[num_categories];
+	
+	size_t 				Total() const;
+	static const char* 	GetName(Category category);
+};
+
+// tunables loaded from config.json, defaults are used for missing keys
+struct Config {
+	int water_anim_ms = 400; // water animation period, 0 disables it
+	int max_fps = 60;        // cap for rendered frames per second, 0 is uncapped
+	int hit_flash_ms = 100;  // duration of hit flash effect
+	int chase_radius = 16;   // enemies closer than this (in steps) chase player
+	int fov_radius = 30;     // sight radius of player (at most 31), 0 shows whole map
+	int sim_radius = 2;      // chunks around player chunk where actors are simulated
+	int sim_threads = 0;     // threads updating enemies, 0 is one per core (at most 8)
+	// per category, 0 is unlimited ("memory_budget_kb": {"tiles": 65536, "objects": 8192, ...})
+	std::array<int, MemoryStats::num_categories> memory_budget_kb = {};
+};
+
 struct Menu {
 	std::string title;
 	std::vector<MenuItem> items;
@@ -108,21 +196,115 @@ public:
 	struct Chunk {
 		static constexpr int xsize = 64;
 		static constexpr int ysize = 64;
+		
+		// lod pyramid, level i summarizes lod_scale[i] x lod_scale[i] tiles per cell
+		static constexpr int lod_levels = 3;
+		static constexpr int lod_scale[lod_levels]  = {2, 4, 16};
+		static constexpr int lod_offset[lod_levels] = {0, 32*32, 32*32 + 16*16};
+		static constexpr int lod_cells = 32*32 + 16*16 + 4*4;
+		
+		// bit-planes of tile features, kept in sync with tiles
+		enum Plane {
+			walkable,
+			blocks_sight,
+			water,
+			actor,
+			item,
+			num_planes
+		};
+		static_assert(xsize == BitPlane::size && ysize == BitPlane::size, "bit-plane row must cover chunk row");
+		
 		std::array<Tile, xsize*ysize> tiles;
+		std::array<TileSummary, lod_cells> lod;
+		std::array<BitPlane, num_planes> planes;
+		BitPlane explored; // tiles player has ever seen, saved with game
+		
+		// outside of active region actors and items are kept only as compact records
+		bool dormant = false;
+		uint32_t dormant_since = 0; // turn when chunk went dormant
+		std::vector<DormantActor> dormant_actors;
+		std::vector<Item> dormant_inventories; // items of dormant actors, in order of records
+		std::vector<DormantItem> dormant_items;
+		uint32_t version = 0; // incremented on every tile change
+		uint32_t terrain_version = 0; // changes when walkability changes, unique across whole model
+		bool generated = false;
 
 		Tile& TileAt(const glm::ivec2& pos) {
 			return tiles[pos.y*xsize + pos.x];
 		}
+		
+		static glm::ivec2 LocalPosition(int index) {
+			return {index % xsize, index / xsize};
+		}
+		
+		TileSummary& SummaryAt(int level, const glm::ivec2& cell) {
+			return lod[lod_offset[level] + cell.y*(xsize/lod_scale[level]) + cell.x];
+		}
+		
+		void UpdateSummary(int level, const glm::ivec2& cell);
+		void BuildSummaries();
+		void UpdatePlanes(const glm::ivec2& pos);
+		void BuildPlanes();
+		// nothing was written into it since it was made (no tiles, explored bits or dormant records)
+		bool IsBlank() const;
 	};
 	
 	// map
 	Chunk& 						GetChunk(const glm::ivec2& pos);
+	Chunk* 						FindChunk(const glm::ivec2& pos);
 	Tile& 						GetTileAt(const glm::ivec2& pos);
+	void 						SetTile(const glm::ivec2& pos, Tile::Type type, Object* obj, uint32_t actor = 0);
+	uint32_t 					GetTerrainVersion() const;
+	size_t 						GetGeneratedChunks() const;
+	size_t 						GetResidentChunks() const;
+	size_t 						GetObjectCount() const;
+	static bool 				IsWalkable(Tile::Type type);
+	static void 				SplitPosition(const glm::ivec2& pos, glm::ivec2& chunk, glm::ivec2& local);
+	
+	// bit-plane queries, tiles of missing chunks have no bits set
+	bool 						TestPlane(Chunk::Plane plane, const glm::ivec2& pos);
+	int 						CountPlane(Chunk::Plane plane, const glm::ivec2& from, const glm::ivec2& to);
+	int 						CountNeighbors(Chunk::Plane plane, const glm::ivec2& pos);
+	
+	// field of view from player, tiles seen once stay explored
+	void 						UpdateFieldOfView();
+	bool 						IsVisible(const glm::ivec2& pos) const;
+	bool 						IsExplored(const glm::ivec2& pos);
+	bool 						IsFogEnabled() const;
+	// visible tiles with plane bit set, at most radius steps from player on each axis
+	void 						FindInSight(Chunk::Plane plane, int radius, std::vector<glm::ivec2>& found);
+	
+	// only chunks around player are simulated, turn counts player moves
+	void 						UpdateActiveRegion();
+	bool 						IsActiveChunk(const glm::ivec2& chunk_pos) const;
+	void 						NextTurn();
+	uint32_t 					GetTurn() const;
+	
+	// actors act when their time comes, faster ones more often
+	static uint32_t 			ActionDelay(int speed);
+	uint32_t 					GetTime() const;
+	void 						ScheduleActor(ActorStore::Slot slot);
+	// ids of actors of earliest due tick not later than until, in scheduling order
+	bool 						PopDueActors(uint32_t until, std::vector<uint32_t>& ids);
 	void						ForEachObject(std::function<void(Object*)> func);
 	void 						RemoveObject(Object* pos);
 	void 						InsertObject(Object* pos);
+	// inserted item, storage of removed objects is reused, id 0 gets new id
+	ItemObject* 				NewItemObject(Item item, glm::ivec2 pos, uint32_t id = 0);
+	
+	// memory by category, categories over budget are trimmed when active region moves
+	// or every budget_check_turns while it stays, those still over afterwards are flagged
+	static constexpr uint32_t budget_check_turns = 256;
+	MemoryStats 				GetMemoryStats();
+	void 						CheckMemoryBudgets();
+	bool 						IsOverBudget(MemoryStats::Category category) const;
 	
-	Actor* 					GetPlayer();
+	// actors, player included
+	ActorStore& 			GetActors();
+	ActorStore::Slot 		InsertActor(uint32_t id, glm::ivec2 pos, const ActorStats& stats);
+	void 					RemoveActor(uint32_t id);
+	uint32_t 				GetPlayerId() const;
+	ActorStore::Slot 		GetPlayerSlot() const;
 	glm::ivec2 				GetPlayerPosition();
 	
 	// game making
@@ -133,6 +315,14 @@ public:
 	void 	LoadGame(std::string jsonFilename);
 	void	LoadConfig(std::string jsonFilename);
 	void	SetSeed(std::string seed);
+	void	SetSeed(uint32_t seed);
+	// hash of actors and items (live and dormant), terrain and occupancy planes, explored
+	// tiles, turn and scheduler time; same for same game state
+	uint64_t GetStateHash();
+	// hash of what a save keeps: actors and items wherever they are (live or dormant), turn
+	// and explored tiles; same before saving and after loading the game
+	uint64_t GetWorldHash();
+	uint32_t GetSeed() const;
 	
 	// which interface should render
 	void 		SetView(ViewType view);
@@ -149,14 +339,28 @@ public:
 	MenuItem& 	GetSelectedItem() const;
 	void		IncrementSelection(int dir);
 	
-	// for combat system
-	void		SetAttackedPos(glm::ivec2 pos);
-	glm::ivec2  GetAttackedPos();
+	// zoomed out map and minimap (zoom level 0 is 1:1)
+	static constexpr int zoom_levels = Chunk::lod_levels + 1;
+	void		SetZoomLevel(int level);
+	int			GetZoomLevel() const;
+	void		ToggleMinimap();
+	bool		IsMinimapShown() const;
+	
+	// timings overlay
+	Profiler&	GetProfiler();
+	void		ToggleProfiler();
+	bool		IsProfilerShown() const;
+	
+	// effects timeline (for combat system)
+	void						QueueEffect(Effect::Type type, glm::ivec2 pos, std::chrono::milliseconds duration);
+	const std::vector<Effect>& 	GetEffects() const;
+	Effect::clock::time_point 	GetNextEffectChange(Effect::clock::time_point now) const;
 	
 	
 	const std::array<char, Tile::Type::num_types>& 	GetCharMap();
 	const std::array<char, 4>& 						GetElevationMap();
 	const ItemDef&		GetItemDef(int idx);
+	const Config&		GetConfig() const;
 
 	void 				SetCanvasSize(const glm::ivec2& win_size);
 	const glm::ivec2& 	GetCanvasSize() const;
@@ -168,15 +372,38 @@ public:
 	
 	
 private:
+	void 	updateChunkActivity(const glm::ivec2& pos, Chunk& chunk);
+	void 	sleepChunk(const glm::ivec2& pos, Chunk& chunk);
+	void 	wakeChunk(const glm::ivec2& pos, Chunk& chunk);
+	void 	sleepActor(Chunk& chunk, uint16_t local, ActorStore::Slot slot);
+	void 	trimMemory(MemoryStats::Category category);
+	uint32_t newObjectId();
+	
 	uint32_t 				m_seed;
-	std::unique_ptr<Actor> 	m_player;
+	ActorStore 				m_actors;
+	uint32_t 				m_player_id;
 	std::vector<ItemDef> 	m_item_defs;
-	std::set<std::unique_ptr<Object>> 					m_objects;
+	ObjectSet 											m_objects;
+	std::vector<ObjectSet::node_type> 					m_free_objects; // removed objects with their set nodes
 	std::map<glm::ivec2, Chunk, vec2_cmp<glm::ivec2>> 	m_chunks;
 	std::set<glm::ivec2, vec2_cmp<glm::ivec2>> 			m_generated_chunks;
 	std::set<glm::ivec2, vec2_cmp<glm::ivec2>> 			m_objects_generated_chunks;
 	std::array<char, Tile::Type::num_types> 			m_char_map;
 	std::array<char, 4> 								m_elevation_map;
+	Config 												m_config;
+	uint32_t 											m_terrain_version;
+	FieldOfView 										m_fov;
+	glm::ivec2 											m_fov_origin; // world position of fov window top left corner
+	uint32_t 											m_fov_terrain_version;
+	uint32_t 											m_turn;
+	Scheduler 											m_scheduler;
+	uint32_t 											m_last_object_id;
+	bool 												m_iterating; // inside ForEachObject
+	std::vector<uint32_t> 								m_due_ids;
+	glm::ivec2 											m_active_center; // chunk of player when region was updated
+	bool 												m_active_valid;
+	uint32_t 											m_over_budget; // bit per memory category
+	uint32_t 											m_budget_check_turn; // turn of last CheckMemoryBudgets
 	
 	glm::ivec2 m_camera_position;
 	
@@ -186,6 +413,10 @@ private:
 	std::stack<Menu*> 		m_menu_stack;
 	ViewType 				m_view;
 	int 					m_selection;
-	glm::ivec2				m_attacked_pos;
+	std::vector<Effect>		m_effects;
 	glm::ivec2				m_canvas_size;
+	int 					m_zoom_level;
+	bool 					m_minimap;
+	bool 					m_profiler_shown;
+	Profiler 				m_profiler;
 };
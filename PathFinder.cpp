@@ -0,0 +1,294 @@
+#include "PathFinder.hpp"
+#include <algorithm>
+#include <cstring>
+
+// chunk sides: west, east, north, south
+static const glm::ivec2 side_dir[4] = {{-1,0}, {1,0}, {0,-1}, {0,1}};
+static int opposite(int side) {
+	return side ^ 1;
+}
+
+// local position of i-th tile on given side of chunk
+static glm::ivec2 border_tile(int side, int i) {
+	const int last = Model::Chunk::xsize - 1;
+	switch(side) {
+		case 0: return {0, i};
+		case 1: return {last, i};
+		case 2: return {i, 0};
+		default: return {i, last};
+	}
+}
+
+// walkable tiles of chunk side, bit i is i-th border tile
+static uint64_t border_mask(const Model::Chunk& chunk, int side) {
+	const BitPlane& walkable = chunk.planes[Model::Chunk::walkable];
+	if(side >= 2) {
+		return walkable.rows[side == 2 ? 0 : BitPlane::size-1];
+	}
+	int bit = side == 0 ? 0 : BitPlane::size-1;
+	uint64_t mask = 0;
+	for(int i = 0; i < BitPlane::size; i++) {
+		mask |= ((walkable.rows[i] >> bit) & 1) << i;
+	}
+	return mask;
+}
+
+static int local_index(glm::ivec2 local) {
+	return local.y * Model::Chunk::xsize + local.x;
+}
+
+static glm::ivec2 local_pos(glm::ivec2 pos) {
+	glm::ivec2 chunk, local;
+	Model::SplitPosition(pos, chunk, local);
+	return local;
+}
+
+static uint32_t manhattan(glm::ivec2 a, glm::ivec2 b) {
+	return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+}
+
+PathFinder::PathFinder() : m_query(0) {}
+
+void PathFinder::Clear() {
+	m_graphs.clear();
+}
+
+size_t PathFinder::GetCachedChunks() const {
+	return m_graphs.size();
+}
+
+// distances from start to every tile of chunk
+void PathFinder::bfs(Model::Chunk& chunk, glm::ivec2 start, std::vector<uint16_t>& dist) {
+	const int size = Model::Chunk::xsize;
+	const BitPlane& walkable = chunk.planes[Model::Chunk::walkable];
+	dist.assign(chunk_tiles, unreachable);
+	m_queue.resize(chunk_tiles);
+	int head = 0, tail = 0;
+	dist[local_index(start)] = 0;
+	m_queue[tail++] = local_index(start);
+	while(head < tail) {
+		int i = m_queue[head++];
+		int x = i % size, y = i / size;
+		uint16_t d = dist[i] + 1;
+		auto visit = [&](int nx, int ny) {
+			if(nx < 0 || ny < 0 || nx >= size || ny >= size) return;
+			int ni = ny*size + nx;
+			if(dist[ni] != unreachable || !((walkable.rows[ny] >> nx) & 1)) return;
+			dist[ni] = d;
+			m_queue[tail++] = ni;
+		};
+		visit(x-1, y);
+		visit(x+1, y);
+		visit(x, y-1);
+		visit(x, y+1);
+	}
+}
+
+// find portals on all sides and distances between them
+void PathFinder::buildGraph(Model* model, ChunkGraph& graph, Model::Chunk& chunk) {
+	graph.portals.clear();
+	for(int side = 0; side < 4; side++) {
+		graph.side_begin[side] = graph.portals.size();
+		Model::Chunk* neighbor = model->FindChunk(graph.chunk_pos + side_dir[side]);
+		if(!neighbor || !neighbor->generated) continue;
+
+		// one portal in the middle of every opening, neighbor finds the same openings
+		uint64_t open_mask = border_mask(chunk, side) & border_mask(*neighbor, opposite(side));
+		int run_start = -1;
+		for(int i = 0; i <= Model::Chunk::xsize; i++) {
+			bool open = i < Model::Chunk::xsize && ((open_mask >> i) & 1);
+			if(open && run_start < 0) {
+				run_start = i;
+			} else if(!open && run_start >= 0) {
+				graph.portals.push_back(graph.chunk_pos * Model::chunk_size + border_tile(side, (run_start + i - 1) / 2));
+				run_start = -1;
+			}
+		}
+	}
+	graph.side_begin[4] = graph.portals.size();
+
+	int n = graph.portals.size();
+	graph.dist.assign(n*n, unreachable);
+	for(int i = 0; i < n; i++) {
+		bfs(chunk, local_pos(graph.portals[i]), m_scratch);
+		for(int j = 0; j < n; j++) {
+			graph.dist[i*n + j] = m_scratch[local_index(local_pos(graph.portals[j]))];
+		}
+	}
+	graph.stamp.assign(n, 0);
+	graph.g.resize(n);
+	graph.parent.resize(n);
+	graph.closed.resize(n);
+}
+
+// cached abstraction of chunk, rebuilt if its or neighbors terrain changed
+PathFinder::ChunkGraph* PathFinder::getGraph(Model* model, glm::ivec2 chunk_pos) {
+	auto it = m_graphs.find(chunk_pos);
+	if(it != m_graphs.end() && it->second.validated == model->GetTerrainVersion()) {
+		return &it->second;
+	}
+	
+	Model::Chunk* chunk = model->FindChunk(chunk_pos);
+	if(!chunk || !chunk->generated) return nullptr;
+
+	ChunkGraph& graph = it != m_graphs.end() ? it->second : m_graphs[chunk_pos];
+	graph.validated = model->GetTerrainVersion();
+
+	uint32_t versions[5] = {chunk->terrain_version};
+	for(int side = 0; side < 4; side++) {
+		Model::Chunk* neighbor = model->FindChunk(chunk_pos + side_dir[side]);
+		versions[side+1] = neighbor && neighbor->generated ? neighbor->terrain_version : 0;
+	}
+	if(std::memcmp(versions, graph.versions, sizeof(versions)) != 0) {
+		std::memcpy(graph.versions, versions, sizeof(versions));
+		graph.chunk_pos = chunk_pos;
+		buildGraph(model, graph, *chunk);
+	}
+	return &graph;
+}
+
+// neighbor graphs are linked once per terrain version, so A* doesn't search map for them
+PathFinder::ChunkGraph* PathFinder::getNeighbor(Model* model, ChunkGraph* graph, int side) {
+	if(graph->linked != model->GetTerrainVersion()) {
+		graph->linked = model->GetTerrainVersion();
+		for(int s = 0; s < 4; s++) {
+			graph->neighbors[s] = getGraph(model, graph->chunk_pos + side_dir[s]);
+		}
+	}
+	return graph->neighbors[side];
+}
+
+bool PathFinder::FindPath(Model* model, glm::ivec2 from, glm::ivec2 to, std::vector<glm::ivec2>& waypoints) {
+	waypoints.clear();
+	m_query++;
+
+	glm::ivec2 from_chunk, from_local, to_chunk, to_local;
+	Model::SplitPosition(from, from_chunk, from_local);
+	Model::SplitPosition(to, to_chunk, to_local);
+	ChunkGraph* start = getGraph(model, from_chunk);
+	ChunkGraph* goal = getGraph(model, to_chunk);
+	if(!start || !goal) return false;
+
+	// inside one chunk try direct path first
+	bfs(*model->FindChunk(from_chunk), from_local, m_start_dist);
+	if(start == goal && m_start_dist[local_index(to_local)] != unreachable) {
+		waypoints = {from, to};
+		return true;
+	}
+	bfs(*model->FindChunk(to_chunk), to_local, m_goal_dist);
+
+	// A* over portals, node with null graph is the goal.
+	// Heuristic is weighted by 1.5, paths may be a bit longer but far less portals get expanded
+	auto& open = m_open;
+	open.clear();
+	const uint32_t inf = UINT32_MAX;
+	uint32_t best_goal = inf;
+	NodeRef goal_parent = {nullptr, -1};
+
+	auto relax = [&](ChunkGraph* graph, int idx, uint32_t g, NodeRef parent) {
+		if(graph->stamp[idx] != m_query) {
+			graph->stamp[idx] = m_query;
+			graph->g[idx] = inf;
+			graph->closed[idx] = 0;
+		}
+		if(g < graph->g[idx]) {
+			graph->g[idx] = g;
+			graph->parent[idx] = parent;
+			open.push_back(Open{g + manhattan(graph->portals[idx], to)*3/2, g, {graph, idx}});
+			std::push_heap(open.begin(), open.end());
+		}
+	};
+
+	for(int i = 0; i < (int)start->portals.size(); i++) {
+		uint16_t d = m_start_dist[local_index(local_pos(start->portals[i]))];
+		if(d != unreachable) {
+			relax(start, i, d, {nullptr, -1});
+		}
+	}
+
+	while(!open.empty()) {
+		std::pop_heap(open.begin(), open.end());
+		Open top = open.back();
+		open.pop_back();
+
+		ChunkGraph* graph = top.node.graph;
+		if(!graph) break; // goal reached with best cost
+		int i = top.node.idx;
+		if(graph->closed[i] || top.g > graph->g[i]) continue;
+		graph->closed[i] = 1;
+
+		// exit to goal
+		if(graph == goal) {
+			uint16_t d = m_goal_dist[local_index(local_pos(graph->portals[i]))];
+			if(d != unreachable && top.g + d < best_goal) {
+				best_goal = top.g + d;
+				goal_parent = top.node;
+				open.push_back(Open{best_goal, best_goal, {nullptr, -1}});
+				std::push_heap(open.begin(), open.end());
+			}
+		}
+
+		// portals of same chunk
+		int n = graph->portals.size();
+		for(int j = 0; j < n; j++) {
+			uint16_t d = graph->dist[i*n + j];
+			if(j != i && d != unreachable) {
+				relax(graph, j, top.g + d, top.node);
+			}
+		}
+
+		// matching portal on other side of border
+		int side = 0;
+		while(i >= graph->side_begin[side+1]) side++;
+		ChunkGraph* neighbor = getNeighbor(model, graph, side);
+		if(neighbor) {
+			int j = neighbor->side_begin[opposite(side)] + (i - graph->side_begin[side]);
+			if(j < neighbor->side_begin[opposite(side)+1]) {
+				relax(neighbor, j, top.g + 1, top.node);
+			}
+		}
+	}
+
+	if(best_goal == inf) return false;
+
+	waypoints.push_back(to);
+	for(NodeRef node = goal_parent; node.graph; node = node.graph->parent[node.idx]) {
+		waypoints.push_back(node.graph->portals[node.idx]);
+	}
+	waypoints.push_back(from);
+	std::reverse(waypoints.begin(), waypoints.end());
+	return true;
+}
+
+bool PathFinder::RefineSegment(Model* model, glm::ivec2 a, glm::ivec2 b, std::vector<glm::ivec2>& path) {
+	if(a == b) return true;
+	if(manhattan(a, b) == 1) {
+		path.push_back(b);
+		return true;
+	}
+
+	glm::ivec2 a_chunk, a_local, b_chunk, b_local;
+	Model::SplitPosition(a, a_chunk, a_local);
+	Model::SplitPosition(b, b_chunk, b_local);
+	Model::Chunk* chunk = model->FindChunk(a_chunk);
+	if(a_chunk != b_chunk || !chunk) return false;
+
+	// walk downhill on distances to b
+	bfs(*chunk, b_local, m_scratch);
+	if(m_scratch[local_index(a_local)] == unreachable) return false;
+	glm::ivec2 pos = a_local;
+	glm::ivec2 origin = a_chunk * Model::chunk_size;
+	while(pos != b_local) {
+		uint16_t d = m_scratch[local_index(pos)];
+		for(auto &dir : side_dir) {
+			glm::ivec2 next = pos + dir;
+			if(glm::any(glm::lessThan(next, glm::ivec2(0))) || glm::any(glm::greaterThanEqual(next, Model::chunk_size))) continue;
+			if(m_scratch[local_index(next)] == d - 1) {
+				pos = next;
+				break;
+			}
+		}
+		path.push_back(origin + pos);
+	}
+	return true;
+}
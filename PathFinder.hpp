@@ -0,0 +1,74 @@
+#pragma once
+#include "Model.hpp"
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// Hierarchical pathfinder (HPA*) over generated chunks.
+// Every chunk border gets portals in the middle of each walkable opening,
+// distances between portals of one chunk are precomputed. Long queries then
+// run A* over portals only. Abstraction is cached per chunk and rebuilt when
+// terrain version of the chunk or one of its neighbors changes.
+class PathFinder {
+public:
+	PathFinder();
+
+	// abstract path: from, border portals on the way, to.
+	// Consecutive waypoints are in the same chunk or adjacent.
+	bool 	FindPath(Model* model, glm::ivec2 from, glm::ivec2 to, std::vector<glm::ivec2>& waypoints);
+
+	// appends tiles leading from a to b (a excluded) for two consecutive waypoints
+	bool 	RefineSegment(Model* model, glm::ivec2 a, glm::ivec2 b, std::vector<glm::ivec2>& path);
+
+	void 	Clear();
+	size_t 	GetCachedChunks() const;
+
+private:
+	static constexpr uint16_t unreachable = 0xffff;
+	static constexpr int chunk_tiles = Model::Chunk::xsize * Model::Chunk::ysize;
+
+	struct ChunkGraph;
+	struct NodeRef {
+		ChunkGraph* graph;
+		int 		idx; // -1 is start node
+	};
+
+	struct Open {
+		uint32_t f;
+		uint32_t g;
+		NodeRef node;
+		bool operator<(const Open& o) const { return f > o.f; }
+	};
+
+	struct ChunkGraph {
+		glm::ivec2 				chunk_pos;
+		uint32_t 				versions[5]; // terrain versions of chunk and its west, east, north, south neighbors
+		std::vector<glm::ivec2> portals; 	 // world positions, grouped by side
+		int 					side_begin[5];
+		std::vector<uint16_t> 	dist; 		 // portals x portals intra chunk distances
+
+		// A* state, valid when stamp equals current query
+		std::vector<uint32_t> 	stamp;
+		std::vector<uint32_t> 	g;
+		std::vector<NodeRef> 	parent;
+		std::vector<uint8_t> 	closed;
+
+		// model terrain version for which graph and neighbor links were checked
+		uint32_t 				validated;
+		uint32_t 				linked;
+		ChunkGraph* 			neighbors[4];
+	};
+
+	ChunkGraph* getGraph(Model* model, glm::ivec2 chunk_pos);
+	ChunkGraph* getNeighbor(Model* model, ChunkGraph* graph, int side);
+	void 		buildGraph(Model* model, ChunkGraph& graph, Model::Chunk& chunk);
+	void 		bfs(Model::Chunk& chunk, glm::ivec2 start, std::vector<uint16_t>& dist);
+
+	std::map<glm::ivec2, ChunkGraph, vec2_cmp<glm::ivec2>> m_graphs;
+	uint32_t 				m_query;
+	std::vector<uint16_t> 	m_scratch;
+	std::vector<uint16_t> 	m_start_dist;
+	std::vector<uint16_t> 	m_goal_dist;
+	std::vector<int> 		m_queue;
+	std::vector<Open> 		m_open;
+};
@@ -0,0 +1,102 @@
+#include "PerfCounters.hpp"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+PerfCounters::PerfCounters() : m_leader(-1) {
+	for(auto &fd : m_fds) fd = -1;
+}
+
+PerfCounters::~PerfCounters() {
+	Close();
+}
+
+bool PerfCounters::IsOpen() const {
+	return m_leader >= 0;
+}
+
+bool PerfCounters::IsAvailable(Counter counter) const {
+	return m_fds[counter] >= 0;
+}
+
+const char* PerfCounters::GetName(Counter counter) {
+	static const char* names[num_counters] = {"cycles", "instructions", "llc misses", "branch misses"};
+	return names[counter];
+}
+
+#ifdef __linux__
+
+bool PerfCounters::Open() {
+	Close();
+	static const uint64_t configs[num_counters] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES, // last level cache
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+	for(int i = 0; i < num_counters; i++) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = m_leader < 0; // group starts with its leader
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		int group = m_leader >= 0 ? m_fds[m_leader] : -1;
+		m_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+		if(m_fds[i] >= 0 && m_leader < 0) {
+			m_leader = i;
+		}
+	}
+	if(m_leader < 0) return false;
+	ioctl(m_fds[m_leader], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_fds[m_leader], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+void PerfCounters::Close() {
+	// members first, leader last
+	int leader_fd = m_leader >= 0 ? m_fds[m_leader] : -1;
+	for(int i = 0; i < num_counters; i++) {
+		if(m_fds[i] >= 0 && i != m_leader) close(m_fds[i]);
+		m_fds[i] = -1;
+	}
+	if(leader_fd >= 0) close(leader_fd);
+	m_leader = -1;
+}
+
+// group read returns number of counters and their values in order of opening
+bool PerfCounters::Read(Values& values) const {
+	std::memset(&values, 0, sizeof(values));
+	if(m_leader < 0) return false;
+	uint64_t data[1 + num_counters];
+	if(read(m_fds[m_leader], data, sizeof(data)) < (ssize_t)sizeof(uint64_t)) return false;
+	uint64_t n = 0;
+	for(int i = 0; i < num_counters && n < data[0]; i++) {
+		if(m_fds[i] >= 0) {
+			values.v[i] = data[1 + n++];
+		}
+	}
+	return true;
+}
+
+#else
+
+bool PerfCounters::Open() {
+	return false;
+}
+
+void PerfCounters::Close() {}
+
+bool PerfCounters::Read(Values& values) const {
+	for(auto &v : values.v) v = 0;
+	return false;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+// Hardware counters of calling thread read through linux perf_event_open.
+// Counters are opened as one group, so they count over the same time.
+// Counters the cpu or kernel refuses (e.g. in virtual machines or with
+// perf_event_paranoid > 2) are left out and read as 0; on other systems Open fails.
+class PerfCounters {
+public:
+	enum Counter {
+		cycles,
+		instructions,
+		llc_misses,
+		branch_misses,
+		num_counters
+	};
+	struct Values {
+		uint64_t v[num_counters];
+	};
+
+	PerfCounters();
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// true if at least one counter was opened
+	bool 	Open();
+	void 	Close();
+	bool 	IsOpen() const;
+	bool 	IsAvailable(Counter counter) const;
+	bool 	Read(Values& values) const;
+	static const char* GetName(Counter counter);
+
+private:
+	int 	m_fds[num_counters]; // -1 when not opened, first opened one leads group
+	int 	m_leader;
+};
@@ -0,0 +1,75 @@
+#include "Profiler.hpp"
+#include <algorithm>
+
+Profiler::Profiler() {
+	Clear();
+}
+
+void Profiler::Clear() {
+	for(auto &s : m_samples) {
+		s.count = 0;
+	}
+	for(auto &t : m_counter_totals) {
+		t = {};
+	}
+}
+
+void Profiler::Record(Phase phase, uint64_t ns) {
+	Samples& s = m_samples[phase];
+	s.ns[s.count % window] = (uint32_t)std::min<uint64_t>(ns, UINT32_MAX);
+	s.count++;
+}
+
+// percentiles of samples currently in window
+Profiler::Stats Profiler::GetStats(Phase phase) const {
+	const Samples& s = m_samples[phase];
+	Stats stats = {s.count, 0, 0, 0};
+	int n = (int)std::min<uint64_t>(s.count, window);
+	if(n == 0) return stats;
+
+	uint32_t sorted[window];
+	std::copy(s.ns, s.ns + n, sorted);
+	std::sort(sorted, sorted + n);
+	stats.p50_ns = sorted[(n-1) / 2];
+	stats.p99_ns = sorted[(n-1) * 99 / 100];
+	stats.max_ns = sorted[n-1];
+	return stats;
+}
+
+bool Profiler::EnableCounters(bool enable) {
+	for(auto &t : m_counter_totals) {
+		t = {};
+	}
+	if(!enable) {
+		m_counters.Close();
+		return true;
+	}
+	return m_counters.IsOpen() || m_counters.Open();
+}
+
+bool Profiler::IsCounting() const {
+	return m_counters.IsOpen();
+}
+
+const PerfCounters& Profiler::GetCounters() const {
+	return m_counters;
+}
+
+const Profiler::CounterTotals& Profiler::GetCounterTotals(Phase phase) const {
+	return m_counter_totals[phase];
+}
+
+void Profiler::addCounters(Phase phase, const PerfCounters::Values& start) {
+	PerfCounters::Values end;
+	m_counters.Read(end);
+	CounterTotals& totals = m_counter_totals[phase];
+	totals.samples++;
+	for(int i = 0; i < PerfCounters::num_counters; i++) {
+		totals.values.v[i] += end.v[i] - start.v[i];
+	}
+}
+
+const char* Profiler::GetName(Phase phase) {
+	static const char* names[num_phases] = {"input", "ai", "generate", "render", "refresh"};
+	return names[phase];
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include "PerfCounters.hpp"
+
+// Durations of engine phases over a sliding window of last samples, shown by
+// in-game overlay. Samples come from PROFILE_SCOPE timers, which exist only when
+// built with PROFILER defined (Makefile profile := true), otherwise they expand
+// to nothing. Phases may nest (input contains ai and generation).
+// With counters enabled every scope also adds hardware counter deltas of main
+// thread to its phase (enemies moved by worker threads are not counted), so
+// --counters is refused by builds without PROFILER.
+// Not thread safe, timers belong to main thread.
+class Profiler {
+	using clock = std::chrono::steady_clock;
+	using clock_point = clock::time_point;
+
+public:
+	enum Phase {
+		input,
+		ai,
+		generation,
+		render,
+		refresh,
+		num_phases
+	};
+	static constexpr int window = 256;
+
+	struct Stats {
+		uint64_t count; // samples recorded since start, window holds at most last 256
+		uint32_t p50_ns;
+		uint32_t p99_ns;
+		uint32_t max_ns;
+	};
+
+	// counters summed over all samples since counters were enabled
+	struct CounterTotals {
+		uint64_t 				samples;
+		PerfCounters::Values 	values;
+	};
+
+	// measures lifetime of the scope
+	class Scope {
+	public:
+		Scope(Profiler& profiler, Phase phase) : m_profiler(profiler), m_phase(phase) {
+			if(m_profiler.IsCounting()) m_profiler.m_counters.Read(m_counters);
+			m_start = clock::now();
+		}
+		~Scope() {
+			m_profiler.Record(m_phase, std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start).count());
+			if(m_profiler.IsCounting()) m_profiler.addCounters(m_phase, m_counters);
+		}
+	private:
+		Profiler& 			m_profiler;
+		Phase 				m_phase;
+		clock_point 		m_start;
+		PerfCounters::Values m_counters;
+	};
+
+	Profiler();
+	void 				Record(Phase phase, uint64_t ns);
+	Stats 				GetStats(Phase phase) const;
+	void 				Clear();
+	static const char* 	GetName(Phase phase);
+
+	// false if no hardware counter could be opened
+	bool 				EnableCounters(bool enable);
+	bool 				IsCounting() const;
+	const PerfCounters& GetCounters() const;
+	const CounterTotals& GetCounterTotals(Phase phase) const;
+
+private:
+	void 				addCounters(Phase phase, const PerfCounters::Values& start);
+
+	struct Samples {
+		uint32_t ns[window]; // ring buffer, saturated at ~4 s
+		uint64_t count;
+	};
+	Samples 		m_samples[num_phases];
+	PerfCounters 	m_counters;
+	CounterTotals 	m_counter_totals[num_phases];
+};
+
+#ifdef PROFILER
+#define PROFILE_SCOPE(profiler, phase) Profiler::Scope profile_scope(profiler, phase)
+#else
+#define PROFILE_SCOPE(profiler, phase)
+#endif
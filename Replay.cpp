@@ -0,0 +1,94 @@
+#include "Replay.hpp"
+#include "Model.hpp"
+#include "libs/json.hpp"
+#include <fstream>
+
+Replay::Replay() : m_started(false), m_seed(0), m_canvas(0), m_next_checkpoint(checkpoint_turns) {}
+
+void Replay::Start(uint32_t seed, glm::ivec2 canvas) {
+	m_started = true;
+	m_seed = seed;
+	m_canvas = canvas;
+	m_keys.clear();
+	m_checkpoints.clear();
+	m_next_checkpoint = checkpoint_turns;
+}
+
+bool Replay::IsStarted() const {
+	return m_started;
+}
+
+void Replay::RecordKey(int key) {
+	m_keys.push_back(key);
+}
+
+void Replay::RecordResize(glm::ivec2 canvas) {
+	m_keys.insert(m_keys.end(), {resize_key, canvas.x, canvas.y});
+}
+
+void Replay::RecordCheckpoint(Model* model) {
+	if(!m_started || m_keys.empty() || model->GetTurn() < m_next_checkpoint) return;
+	m_checkpoints.push_back({uint32_t(m_keys.size() - 1), model->GetTurn(), model->GetStateHash()});
+	m_next_checkpoint = (model->GetTurn() / checkpoint_turns + 1) * checkpoint_turns;
+}
+
+bool Replay::Save(std::string filename) const {
+	using namespace nlohmann;
+	if(!m_started) return false;
+	json j;
+	j["seed"] = m_seed;
+	j["canvas"] = {m_canvas.x, m_canvas.y};
+	j["keys"] = m_keys;
+	j["checkpoints"] = json::array();
+	for(auto &c : m_checkpoints) {
+		j["checkpoints"].push_back({c.key, c.turn, c.hash});
+	}
+	std::ofstream f(filename);
+	f << j;
+	return (bool)f;
+}
+
+bool Replay::Load(std::string filename) {
+	using namespace nlohmann;
+	std::ifstream f(filename);
+	if(!f) return false;
+	// malformed file or missing fields leave replay as it was
+	uint32_t seed;
+	glm::ivec2 canvas;
+	std::vector<int> keys;
+	std::vector<Checkpoint> checkpoints;
+	try {
+		json j;
+		f >> j;
+		seed = j.at("seed");
+		canvas = {j.at("canvas").at(0), j.at("canvas").at(1)};
+		keys = j.at("keys").get<std::vector<int>>();
+		for(auto &c : j.at("checkpoints")) {
+			checkpoints.push_back({c.at(0), c.at(1), c.at(2)});
+		}
+	} catch(const json::exception&) {
+		return false;
+	}
+	m_started = true;
+	m_seed = seed;
+	m_canvas = canvas;
+	m_keys = std::move(keys);
+	m_checkpoints = std::move(checkpoints);
+	return true;
+}
+
+uint32_t Replay::GetSeed() const {
+	return m_seed;
+}
+
+glm::ivec2 Replay::GetCanvas() const {
+	return m_canvas;
+}
+
+const std::vector<int>& Replay::GetKeys() const {
+	return m_keys;
+}
+
+const std::vector<Replay::Checkpoint>& Replay::GetCheckpoints() const {
+	return m_checkpoints;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class Model;
+
+// Seed, canvas size and key presses of one game with world hashes at checkpoints.
+// All randomness comes from seed, turn and actor ids, so pressing same keys again
+// repeats the game exactly. Canvas size is part of it because it decides which
+// chunks are generated when.
+class Replay {
+public:
+	static constexpr int resize_key = -1; // followed by width and height in keys
+	static constexpr uint32_t checkpoint_turns = 100;
+
+	struct Checkpoint {
+		uint32_t 	key; // index of last key before checkpoint
+		uint32_t 	turn;
+		uint64_t 	hash;
+	};
+	struct Result {
+		uint32_t 	turns;
+		int 		passed;
+		int 		failed;
+		uint32_t 	first_failed_turn;
+	};
+
+	Replay();
+	void 	Start(uint32_t seed, glm::ivec2 canvas);
+	bool 	IsStarted() const;
+	void 	RecordKey(int key);
+	void 	RecordResize(glm::ivec2 canvas);
+	// adds checkpoint when turn reached next multiple of checkpoint_turns
+	void 	RecordCheckpoint(Model* model);
+
+	bool 	Save(std::string filename) const;
+	// false if file can't be read or isn't a replay
+	bool 	Load(std::string filename);
+
+	uint32_t 						GetSeed() const;
+	glm::ivec2 						GetCanvas() const;
+	const std::vector<int>& 		GetKeys() const;
+	const std::vector<Checkpoint>& 	GetCheckpoints() const;
+
+private:
+	bool 					m_started;
+	uint32_t 				m_seed;
+	glm::ivec2 				m_canvas;
+	std::vector<int> 		m_keys;
+	std::vector<Checkpoint> m_checkpoints;
+	uint32_t 				m_next_checkpoint;
+};
@@ -0,0 +1,83 @@
+#include "Scheduler.hpp"
+#include <algorithm>
+
+Scheduler::Scheduler() {
+	Clear();
+}
+
+// entries stay allocated for next game
+void Scheduler::Clear(uint32_t time) {
+	m_free = m_entries.empty() ? none : 0;
+	for(uint32_t i = 0; i < m_entries.size(); i++) {
+		m_entries[i].next = i + 1 < m_entries.size() ? i + 1 : none;
+	}
+	m_buckets.fill({none, none});
+	m_time = time;
+	m_size = 0;
+}
+
+void Scheduler::Schedule(uint32_t id, uint32_t time) {
+	time = std::min(std::max(time, m_time), m_time + wheel_size - 1);
+	uint32_t e = m_free;
+	if(e == none) {
+		e = m_entries.size();
+		m_entries.push_back({id, none});
+	} else {
+		m_free = m_entries[e].next;
+		m_entries[e] = {id, none};
+	}
+	Bucket& bucket = m_buckets[time % wheel_size];
+	if(bucket.last == none) {
+		bucket.first = e;
+	} else {
+		m_entries[bucket.last].next = e;
+	}
+	bucket.last = e;
+	m_size++;
+}
+
+bool Scheduler::PopDue(uint32_t until, uint32_t& id, uint32_t& time) {
+	while(true) {
+		Bucket& bucket = m_buckets[m_time % wheel_size];
+		if(bucket.first != none) {
+			uint32_t e = bucket.first;
+			id = m_entries[e].id;
+			time = m_time;
+			bucket.first = m_entries[e].next;
+			if(bucket.first == none) bucket.last = none;
+			m_entries[e].next = m_free;
+			m_free = e;
+			m_size--;
+			return true;
+		}
+		if(m_time >= until) return false;
+		// nothing queued, jump straight to until
+		m_time = m_size == 0 ? until : m_time + 1;
+	}
+}
+
+bool Scheduler::PopDueTick(uint32_t until, std::vector<uint32_t>& ids, uint32_t& time) {
+	ids.clear();
+	uint32_t id;
+	if(!PopDue(until, id, time)) return false;
+	ids.push_back(id);
+	// rest of bucket goes to free list as a whole
+	Bucket& bucket = m_buckets[m_time % wheel_size];
+	if(bucket.first == none) return true;
+	for(uint32_t e = bucket.first; e != none; e = m_entries[e].next) {
+		ids.push_back(m_entries[e].id);
+		m_size--;
+	}
+	m_entries[bucket.last].next = m_free;
+	m_free = bucket.first;
+	bucket = {none, none};
+	return true;
+}
+
+uint32_t Scheduler::GetTime() const {
+	return m_time;
+}
+
+size_t Scheduler::Size() const {
+	return m_size;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Timing wheel of object ids keyed by time of their next action.
+// Delays are shorter than the wheel, so a bucket only ever holds entries of one time
+// and popping touches just the buckets between last pop and now.
+// Buckets are lists in one pool of entries, so it allocates only when more entries
+// are scheduled than ever before, however they spread over the wheel.
+// Entries are never removed, owner skips the ones which became stale.
+class Scheduler {
+public:
+	static constexpr uint32_t wheel_size = 256;
+	
+	Scheduler();
+	void 		Clear(uint32_t time = 0);
+	// time is clamped to [GetTime(), GetTime() + wheel_size)
+	void 		Schedule(uint32_t id, uint32_t time);
+	// next entry due not later than until, in time then insertion order
+	bool 		PopDue(uint32_t until, uint32_t& id, uint32_t& time);
+	// all entries of earliest due time not later than until
+	bool 		PopDueTick(uint32_t until, std::vector<uint32_t>& ids, uint32_t& time);
+	uint32_t 	GetTime() const;
+	size_t 		Size() const;
+
+private:
+	static constexpr uint32_t none = 0xffffffff;
+
+	struct Entry {
+		uint32_t id;
+		uint32_t next; // in bucket or in free list
+	};
+	struct Bucket {
+		uint32_t first;
+		uint32_t last;
+	};
+
+	std::vector<Entry> 					m_entries;
+	std::array<Bucket, wheel_size> 		m_buckets;
+	uint32_t 	m_free;   // first unused entry
+	uint32_t 	m_time;   // time of bucket being popped
+	size_t 		m_size;
+};
@@ -0,0 +1,78 @@
+#include "Trace.hpp"
+#include "libs/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::s_enabled(false);
+
+namespace {
+
+// buffers live until exit, so events of finished threads can still be saved
+std::mutex g_buffers_mutex;
+std::vector<std::unique_ptr<Trace::Buffer>> g_buffers;
+
+// ticks and nanoseconds when tracing was first enabled
+std::atomic<uint64_t> g_origin_ticks(0);
+std::atomic<int64_t> g_origin_ns(0);
+
+int64_t clockNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+Trace::Buffer* Trace::threadBuffer() {
+	if(!t_buffer) {
+		std::lock_guard<std::mutex> lock(g_buffers_mutex);
+		g_buffers.emplace_back(new Buffer());
+		t_buffer = g_buffers.back().get();
+		t_buffer->count = 0;
+		t_buffer->tid = g_buffers.size();
+	}
+	return t_buffer;
+}
+
+void Trace::Enable(bool enable) {
+	if(enable && g_origin_ns == 0) {
+		g_origin_ns = clockNs();
+		g_origin_ticks = Now();
+	}
+	s_enabled = enable;
+}
+
+void Trace::Clear() {
+	std::lock_guard<std::mutex> lock(g_buffers_mutex);
+	for(auto &buffer : g_buffers) {
+		buffer->count = 0;
+	}
+}
+
+bool Trace::Save(const std::string& filename) {
+	using nlohmann::json;
+	json events = json::array();
+	// tick rate measured over whole tracing time, trace timestamps are microseconds
+	uint64_t origin = g_origin_ticks;
+	double elapsed_ticks = double(Now() - origin);
+	double us_per_tick = elapsed_ticks > 0 ? (clockNs() - g_origin_ns) / elapsed_ticks / 1000.0 : 0.001;
+	{
+		std::lock_guard<std::mutex> lock(g_buffers_mutex);
+		for(auto &buffer : g_buffers) {
+			uint64_t count = buffer->count.load(std::memory_order_acquire);
+			events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid},
+				{"args", {{"name", "thread " + std::to_string(buffer->tid)}}}});
+			for(uint64_t i = count - std::min(count, capacity); i < count; i++) {
+				const Event& e = buffer->events[i % capacity];
+				events.push_back({{"name", e.name}, {"ph", "X"}, {"pid", 1}, {"tid", buffer->tid},
+					{"ts", int64_t(e.start - origin) * us_per_tick}, {"dur", e.duration * us_per_tick}});
+			}
+		}
+	}
+	std::ofstream f(filename);
+	if(!f) return false;
+	f << json{{"traceEvents", events}, {"displayTimeUnit", "ns"}};
+	return bool(f);
+}
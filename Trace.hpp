@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Trace of scoped events in Chrome trace-event format (chrome://tracing, Perfetto).
+// Every thread writes into its own ring buffer of last 32k events, so recording
+// takes no locks; a lock is taken only when a thread records its first event.
+// Time is read from time stamp counter where available (steady clock costs
+// about as much as the whole event), Save converts it to wall time.
+// Disabled tracing costs one relaxed load per scope, enabled one is inlined up to the
+// first event of a thread.
+// Save may run while other threads record, events being written then can be torn.
+class Trace {
+public:
+	// complete event, times in ticks of Now()
+	struct Event {
+		const char* name; // string literal
+		uint64_t 	start;
+		uint64_t 	duration;
+	};
+
+	static constexpr uint64_t capacity = 1 << 15;
+
+	// ring buffer of one thread, written only by it, count is published after event is complete
+	struct Buffer {
+		Event 					events[capacity];
+		std::atomic<uint64_t> 	count;
+		int 					tid;
+	};
+
+	class Scope {
+	public:
+		explicit Scope(const char* name) : m_name(IsEnabled() ? name : nullptr), m_start(m_name ? Now() : 0) {}
+		~Scope() {
+			if(m_name) Record(m_name, m_start, Now());
+		}
+	private:
+		const char* m_name;
+		uint64_t 	m_start;
+	};
+
+	static void 	Enable(bool enable);
+	static bool 	IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+	static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+	static void 	Record(const char* name, uint64_t start, uint64_t end) {
+		Buffer* buffer = t_buffer ? t_buffer : threadBuffer();
+		uint64_t n = buffer->count.load(std::memory_order_relaxed);
+		buffer->events[n % capacity] = {name, start, end - start};
+		buffer->count.store(n + 1, std::memory_order_release);
+	}
+
+	// writes events of all threads as trace JSON, false if file can't be written
+	static bool 	Save(const std::string& filename);
+	static void 	Clear();
+
+private:
+	// registers buffer of calling thread
+	static Buffer* 	threadBuffer();
+
+	static std::atomic<bool> s_enabled;
+	inline static thread_local Buffer* t_buffer = nullptr;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 // #include <algorithm>
 // map vector compare operator
 template<typename T = glm::ivec2>
@@ -51,6 +52,17 @@ static glm::ivec2 neg_mod(glm::ivec2 val, glm::ivec2 m) {
 	return m*(val < 0) + val;
 }
 
+// stateless random number, same keys always give same number (splitmix64 finalizer)
+static uint32_t hash_random(uint32_t a, uint32_t b, uint32_t c) {
+	uint64_t x = ((uint64_t)a << 32 | b) ^ ((uint64_t)c * 0x9E3779B97F4A7C15ull);
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return (uint32_t)x;
+}
+
 class VecIterate {
  public:
 	using value = glm::ivec2;
@@ -7,21 +7,28 @@
 #include "ViewColors.hpp"
 
 View::View(Model* _model, Signals* _signals) : model(_model), signals(_signals) {
-	signals->sig_new_frame.connect(std::bind(&View::Render, this));
+	signals->sig_new_frame.connect(std::bind(&View::requestFrame, this));
 	signals->sig_quit.connect(std::bind(&View::Quit, this));
 }
 
 void View::Init() {
-	// init curses
-	initscr();
+	// init curses, unless caller already made its own screen (bench renders to /dev/null)
+	if(!stdscr) initscr();
 	cbreak();
 	int h,w;
 	m_window = newwin(LINES,COLS,0,0);
 	keypad(m_window, true);
 	m_window_size = {0,0};
+	m_layout = {-1,-1,-1};
 	curs_set(0); // hide cursor
 	noecho();
 	m_game_window = m_window;
+	m_water_phase = 0;
+	m_next_water_tick = std::chrono::steady_clock::now();
+	m_next_frame = m_next_water_tick;
+	m_frame_dirty = false;
+	m_cells_dirty = false;
+	m_frames = {};
 	updateWindowSize();
 	// init colors for water, trees and mountains
 	start_color();
@@ -41,11 +48,91 @@ View::~View() {
 }
 
 void View::GetInput() {
+	using clock = std::chrono::steady_clock;
+	using std::chrono::milliseconds;
+	
+	// present frame requested by previous input batch before waiting
+	presentFrame();
+	
+	// wait for key no longer than until next timed event:
+	// water animation tick, pending frame or start/end of an effect
+	auto now = clock::now();
+	int anim_ms = model->GetConfig().water_anim_ms;
+	auto effect_change = model->GetNextEffectChange(now);
+	auto deadline = effect_change;
+	if(anim_ms > 0) {
+		deadline = std::min(deadline, m_next_water_tick);
+	}
+	if(m_frame_dirty || m_cells_dirty) {
+		deadline = std::min(deadline, m_next_frame);
+	}
+	if(deadline == clock::time_point::max()) {
+		wtimeout(m_window, -1);
+	} else {
+		auto wait = std::chrono::ceil<milliseconds>(deadline - now).count();
+		wtimeout(m_window, std::max<int>(0, wait));
+	}
+	
 	int c = wgetch(m_window);
 	// fc << "ch " << c << "\n";
+	if(c != ERR) {
+		dispatchKey(c);
+		
+		// drain keys which are already queued, they all share one frame
+		wtimeout(m_window, 0);
+		while((c = wgetch(m_window)) != ERR) {
+			dispatchKey(c);
+		}
+	}
+	
+	if(clock::now() >= effect_change) {
+		requestFrame();
+	}
+	
+	if(anim_ms > 0 && clock::now() >= m_next_water_tick) {
+		m_next_water_tick = clock::now() + milliseconds(anim_ms);
+		if(!m_frame_dirty) { // pending frame will repaint water anyway
+			animateWater();
+		}
+	}
+}
+
+void View::dispatchKey(int c) {
+	// curses catches SIGWINCH and reports it as KEY_RESIZE, layout is redone here once per resize
+	if(c == KEY_RESIZE) {
+#ifndef NCURSES
+		resize_term(0, 0);
+#endif
+		updateWindowSize();
+		return;
+	}
 	signals->sig_input(c);
 }
 
+// frames are only requested by signals, rendering happens here at most once per input batch
+void View::requestFrame() {
+	m_frames.requested++;
+	m_frame_dirty = true;
+}
+
+void View::presentFrame() {
+	auto now = std::chrono::steady_clock::now();
+	if(!(m_frame_dirty || m_cells_dirty) || now < m_next_frame) return;
+	if(m_frame_dirty) {
+		Render();
+	} else {
+		PROFILE_SCOPE(model->GetProfiler(), Profiler::refresh);
+		wrefresh(m_window);
+		m_cells_dirty = false;
+	}
+	int max_fps = model->GetConfig().max_fps;
+	m_next_frame = now + (max_fps > 0 ? std::chrono::microseconds(1000000 / max_fps) : std::chrono::microseconds(0));
+}
+
+const View::FrameStats& View::GetFrameStats() const {
+	return m_frames;
+}
+
 void View::Quit() {
 	
 	endwin();
@@ -144,6 +231,7 @@ void View::renderMenu() {
 	}
 }
 
+// called only on init and resize, never while rendering
 void View::updateWindowSize() {
 	int mx,my;
 	getmaxyx(stdscr, my, mx);
@@ -151,37 +239,34 @@ void View::updateWindowSize() {
 	if(m_window_size != new_win_size) {
 		m_lt_draw_offset = {0,2};
 		m_rb_draw_offset = {0,0};
-		signals->sig_canvas_size_changed(new_win_size - m_lt_draw_offset - m_rb_draw_offset);
 		m_window_size = new_win_size;
+		wresize(m_window, my, mx);
+		
+		// drop caches of old layout, camera and chunks are updated by controller
+		m_water_cells.clear();
+		m_layout = {-1,-1,-1};
+		signals->sig_canvas_size_changed(new_win_size - m_lt_draw_offset - m_rb_draw_offset);
+		requestFrame();
 	}
 }
 
-void View::renderGame() {
-	auto player = model->GetPlayer();
+// foreground/background color of tile
+static glm::ivec2 tile_color(int type, int elevation) {
+	static int elevation_color_palette[] = {
+		0b001,0b011,0b011,0b110,0b111
+	};
 	
-	// game draw area (we can easily define drawing canvas)
-	glm::ivec2 draw_size = model->GetCanvasSize();
-	
-	// clear window (commented out because it adds flickering)
-	// wclear(m_window);
-	
-	// draw status bar
-	mvwhline(m_window, 0, 0, ' ', m_window_size.x);
-	wmove(m_window, 0,0);
-	
-	if(0) { // debug only
-		glm::ivec2 campos = model->GetCameraPos();
-		wprintw(m_window, "campos: %d %d ", player->position.x, player->position.y, campos.x, campos.y);
-		wprintw(m_window, "wsize: %d %d ", m_window_size.x, m_window_size.y);
+	glm::ivec2 color = {7, elevation_color_palette[elevation+2]};
+	if(type == Tile::tree) {
+		color.x = 0b010;
+		color.y = 0b010;
 	}
-	
-	wprintw(m_window, "pos: %d %d | health: %d | armor: %d | damage: %d", player->position.x, player->position.y, player->hp, player->armor, player->damage);
-	mvwhline(m_window, 1, 0, 0, m_window_size.x);
-	//
-	
-	// make camera centered
+	return color;
+}
+
+// draws tiles of visible chunks, pos_offset is world position of top left corner
+void View::renderTiles(glm::ivec2 pos_offset, glm::ivec2 draw_size) {
 	static glm::ivec2 chunk_size 	= glm::ivec2(Model::Chunk::xsize, Model::Chunk::ysize);
-	glm::ivec2 pos_offset   = model->GetCameraPos() - draw_size/2;
 	glm::ivec2 chunk_local  = pos_offset % chunk_size;
 	glm::ivec2 chunk_offset = pos_offset / chunk_size;
 	
@@ -191,7 +276,6 @@ void View::renderGame() {
 	
 	// number of chunks that can fit on window
 	glm::ivec2 chunks_max = num_chunks(draw_size + chunk_local, chunk_size);
-	glm::ivec2 abs_player_pos = glm::abs(player->position); // for water animation
 	// render visible chunks
 	for(int yc = 0; yc < chunks_max.y; yc++) {
 		for(int xc = 0; xc < chunks_max.x; xc++) {
@@ -199,6 +283,8 @@ void View::renderGame() {
 			glm::ivec2 chunk_pos(xc, yc);
 			glm::ivec2 relpos = chunk_pos*chunk_size;
 			auto &chunk = model->GetChunk(chunk_offset + chunk_pos);
+			glm::ivec2 chunk_origin = (chunk_offset + chunk_pos)*chunk_size;
+			bool fog = model->IsFogEnabled();
 			
 			/*
 					    |                    |
@@ -221,28 +307,30 @@ void View::renderGame() {
 				for(int x = 0; x < length.x; x++) {
 					glm::ivec2 pos 	= offset_lt + glm::ivec2(x,y);
 					auto &obj 		= chunk.TileAt(pos);
+					glm::ivec2 put_pos = relpos - offset_rb + m_lt_draw_offset + glm::ivec2(x,y);
 					
-					glm::ivec2 color = {7,0};
-					
-					static int elevation_color_palette[] = {
-						0b001,0b011,0b011,0b110,0b111
-					};
-					
-					color.y = elevation_color_palette[obj.elevation+2];
-					
-					if(obj.type == Tile::tree) {
-						color.x = 0b010;
-						color.y = 0b010;
+					// outside of sight only explored terrain is drawn, dimmed and without actors or items
+					if(fog && !model->IsVisible(chunk_origin + pos)) {
+						if(!chunk.explored.Test(pos)) {
+							mvwaddch(m_window, put_pos.y, put_pos.x, ' ');
+							continue;
+						}
+						glm::ivec2 color = tile_color(obj.type, obj.elevation);
+						color = {obj.type == Tile::tree ? color.x : color.y, 0};
+						setcolor(m_window, color.x, color.y);
+						mvwaddch(m_window, put_pos.y, put_pos.x, Model::IsWalkable(obj.type) ?
+							model->GetElevationMap()[obj.elevation+2] : model->GetCharMap()[(int)obj.type]);
+						unsetcolor(m_window, color.x, color.y);
+						continue;
 					}
 					
-					glm::ivec2 put_pos = relpos - offset_rb + m_lt_draw_offset + glm::ivec2(x,y);
+					glm::ivec2 color = tile_color(obj.type, obj.elevation);
 					setcolor(m_window, color.x, color.y);
 					if(obj.type == Tile::water) {
-						// animated water
-						static int water_anim = 0;
-						water_anim = (x+y) & 1;
+						// animated water, remembered so timer can repaint it alone
+						m_water_cells.push_back({put_pos, color});
 						mvwprintw(m_window, put_pos.y, put_pos.x, "%c", 
-							(water_anim ^ (abs_player_pos.x^abs_player_pos.y)&1) ? ' ' : model->GetCharMap()[(int)obj.type]);
+							((put_pos.x+put_pos.y+m_water_phase)&1) ? ' ' : model->GetCharMap()[(int)obj.type]);
 					} else {
 						mvwprintw(m_window, put_pos.y, put_pos.x, "%c", 
 							obj.type == Tile::empty ? model->GetElevationMap()[obj.elevation+2] : model->GetCharMap()[(int)obj.type]);
@@ -252,22 +340,236 @@ void View::renderGame() {
 			}
 		}
 	}
+}
+
+// draws map from lod summaries of generated chunks, never touching tiles
+void View::renderSummaries(int level, glm::ivec2 center, glm::ivec2 screen_pos, glm::ivec2 size) {
+	int scale = Model::Chunk::lod_scale[level];
+	glm::ivec2 cells_per_chunk = Model::chunk_size / scale;
+	
+	// position in summary cells of top left corner
+	glm::ivec2 cell_offset = center/scale - size/2;
+	glm::ivec2 player_cell = model->GetPlayerPosition();
+	player_cell = player_cell/scale - (player_cell % scale < 0);
+	
+	const auto &charmap = model->GetCharMap();
+	const auto &elevmap = model->GetElevationMap();
+	
+	Model::Chunk* chunk = nullptr;
+	glm::ivec2 last_chunk_pos;
+	for(int y = 0; y < size.y; y++) {
+		for(int x = 0; x < size.x; x++) {
+			glm::ivec2 cell = cell_offset + glm::ivec2(x,y);
+			glm::ivec2 local = cell % cells_per_chunk;
+			glm::ivec2 chunk_pos = cell / cells_per_chunk - (local < 0);
+			local = neg_mod(local, cells_per_chunk);
+			
+			if(!chunk || chunk_pos != last_chunk_pos) {
+				chunk = model->FindChunk(chunk_pos);
+				last_chunk_pos = chunk_pos;
+			}
+			
+			glm::ivec2 put_pos = screen_pos + glm::ivec2(x,y);
+			if(!chunk || !chunk->generated) {
+				mvwaddch(m_window, put_pos.y, put_pos.x, ' ');
+				continue;
+			}
+			
+			// unexplored cells stay blank
+			if(model->IsFogEnabled() && chunk->explored.Count(local*scale, (local+1)*scale) == 0) {
+				mvwaddch(m_window, put_pos.y, put_pos.x, ' ');
+				continue;
+			}
+			
+			auto &summary = chunk->SummaryAt(level, local);
+			glm::ivec2 color = tile_color(summary.type, summary.elevation);
+			char ch = summary.type == Tile::empty ? elevmap[summary.elevation+2] : charmap[summary.type];
+			if(cell == player_cell) {
+				ch = charmap[Tile::friendly];
+			} else if(summary.actors * 64 >= scale*scale) { // only crowded cells when far out
+				ch = charmap[Tile::enemy];
+			}
+			setcolor(m_window, color.x, color.y);
+			mvwaddch(m_window, put_pos.y, put_pos.x, ch);
+			unsetcolor(m_window, color.x, color.y);
+		}
+	}
+}
+
+// small overview in top right corner, drawn from coarsest lod level
+void View::renderMinimap() {
+	glm::ivec2 size(24, 12);
+	glm::ivec2 pos(m_window_size.x - size.x - 1, m_lt_draw_offset.y + 1);
+	if(pos.x < 1 || pos.y + size.y + 1 > m_window_size.y) return;
+	
+	drawRect(pos + size/2, size + 1);
+	renderSummaries(Model::Chunk::lod_levels-1, model->GetPlayerPosition(), pos + 1, size - 1);
+	
+	// water animation must not paint over minimap
+	m_water_cells.erase(std::remove_if(m_water_cells.begin(), m_water_cells.end(), [&](const WaterCell& c) {
+		return c.pos.x >= pos.x && c.pos.x <= pos.x + size.x && c.pos.y >= pos.y && c.pos.y <= pos.y + size.y;
+	}), m_water_cells.end());
+}
+
+// phase timings in top left corner, microseconds over last samples, memory of model
+// in KB (! is over budget), requested and rendered frames and hardware counters per
+// call if they are enabled
+void View::renderProfiler() {
+	if(!model->IsProfilerShown()) return;
+	Profiler& profiler = model->GetProfiler();
+	bool counting = profiler.IsCounting();
+	glm::ivec2 size(38, counting ? 18 : 12);
+	glm::ivec2 pos(1, m_lt_draw_offset.y + 1);
+	if(pos.x + size.x + 1 > m_window_size.x || pos.y + size.y + 1 > m_window_size.y) return;
+	
+	for(int y = 1; y < size.y; y++) {
+		mvwhline(m_window, pos.y + y, pos.x + 1, ' ', size.x - 1);
+	}
+	drawRect(pos + size/2, size + 1);
+	mvwprintw(m_window, pos.y + 1, pos.x + 2, "%-9s %7s %7s %7s", "us", "p50", "p99", "max");
+	for(int i = 0; i < Profiler::num_phases; i++) {
+		auto phase = Profiler::Phase(i);
+		auto stats = profiler.GetStats(phase);
+		mvwprintw(m_window, pos.y + 2 + i, pos.x + 2, "%-9s %7u %7u %7u", Profiler::GetName(phase),
+			stats.p50_ns / 1000, stats.p99_ns / 1000, stats.max_ns / 1000);
+	}
+	mvwprintw(m_window, pos.y + 2 + Profiler::num_phases, pos.x + 2, "chunks %zu objects %zu actors %zu",
+		model->GetResidentChunks(), model->GetObjectCount(), model->GetActors().Size());
+	
+	MemoryStats memory = model->GetMemoryStats();
+	for(int i = 0; i < MemoryStats::num_categories; i += 2) {
+		auto a = MemoryStats::Category(i), b = MemoryStats::Category(i+1);
+		mvwprintw(m_window, pos.y + 3 + Profiler::num_phases + i/2, pos.x + 2, "%-8s %7zu%c  %-8s %7zu%c",
+			MemoryStats::GetName(a), memory.bytes[a] / 1024, model->IsOverBudget(a) ? '!' : ' ',
+			MemoryStats::GetName(b), memory.bytes[b] / 1024, model->IsOverBudget(b) ? '!' : ' ');
+	}
 	
-	// draw attack effect if in view
-	auto atk_pos = model->GetAttackedPos();
-	if( isInRect(atk_pos, pos_offset, draw_size) ) {
-		auto &obj 	= model->GetTileAt(atk_pos);
-		setcolor(m_window, 4,0);
-		auto p = atk_pos - pos_offset + m_lt_draw_offset;
-		mvwprintw(m_window, p.y, p.x, "%c", model->GetCharMap()[(int)obj.type]);
-		unsetcolor(m_window, 4,0);
+	mvwprintw(m_window, pos.y + 6 + Profiler::num_phases, pos.x + 2, "frames requested %lu rendered %lu",
+		(unsigned long)m_frames.requested, (unsigned long)m_frames.rendered);
+	
+	if(counting) {
+		int y = pos.y + 7 + Profiler::num_phases;
+		mvwprintw(m_window, y, pos.x + 2, "%-8s %6s %5s %6s %6s", "per call", "kcyc", "ipc", "llc", "brmiss");
+		for(int i = 0; i < Profiler::num_phases; i++) {
+			auto phase = Profiler::Phase(i);
+			auto &totals = profiler.GetCounterTotals(phase);
+			auto &v = totals.values.v;
+			double calls = std::max<uint64_t>(totals.samples, 1);
+			double ipc = v[PerfCounters::cycles] ? double(v[PerfCounters::instructions]) / v[PerfCounters::cycles] : 0;
+			mvwprintw(m_window, y + 1 + i, pos.x + 2, "%-8s %6.0f %5.2f %6.0f %6.0f", Profiler::GetName(phase),
+				v[PerfCounters::cycles] / calls / 1000, ipc, v[PerfCounters::llc_misses] / calls, v[PerfCounters::branch_misses] / calls);
+		}
 	}
+	
+	m_water_cells.erase(std::remove_if(m_water_cells.begin(), m_water_cells.end(), [&](const WaterCell& c) {
+		return c.pos.x >= pos.x && c.pos.x <= pos.x + size.x && c.pos.y >= pos.y && c.pos.y <= pos.y + size.y;
+	}), m_water_cells.end());
 }
 
-void View::Render() {
-	// get window size in case it changed
-	updateWindowSize();
+void View::renderGame() {
+	auto &actors = model->GetActors();
+	ActorStore::Slot player = model->GetPlayerSlot();
+	glm::ivec2 player_pos = actors.position[player];
+	auto &stats = actors.stats[player];
+	
+	// game draw area (we can easily define drawing canvas)
+	glm::ivec2 draw_size = model->GetCanvasSize();
+	
+	// clear window (commented out because it adds flickering)
+	// wclear(m_window);
 	
+	// repaint whole screen when map layout changes, so nothing from previous layout is left
+	int zoom = model->GetZoomLevel();
+	glm::ivec3 layout(zoom, model->IsMinimapShown(), model->IsProfilerShown());
+	if(layout != m_layout) {
+		wclear(m_window);
+		m_layout = layout;
+	}
+	
+	// draw status bar
+	mvwhline(m_window, 0, 0, ' ', m_window_size.x);
+	wmove(m_window, 0,0);
+	
+	if(0) { // debug only
+		glm::ivec2 campos = model->GetCameraPos();
+		wprintw(m_window, "campos: %d %d ", player_pos.x, player_pos.y, campos.x, campos.y);
+		wprintw(m_window, "wsize: %d %d ", m_window_size.x, m_window_size.y);
+	}
+	
+	wprintw(m_window, "pos: %d %d | health: %d | armor: %d | damage: %d", player_pos.x, player_pos.y, stats.hp, stats.armor, stats.damage);
+	if(model->IsProfilerShown()) {
+		auto input = model->GetProfiler().GetStats(Profiler::input);
+		wprintw(m_window, " | turn p99: %.2f ms", input.p99_ns / 1e6);
+	}
+	mvwhline(m_window, 1, 0, 0, m_window_size.x);
+	//
+	
+	// make camera centered
+	glm::ivec2 pos_offset = model->GetCameraPos() - draw_size/2;
+	m_water_cells.clear();
+	
+	if(zoom > 0) {
+		// zoomed out map is drawn only from chunk summaries
+		renderSummaries(zoom-1, model->GetCameraPos(), m_lt_draw_offset, draw_size);
+		return;
+	}
+	
+	renderTiles(pos_offset, draw_size);
+	
+	// draw active attack effects if in view
+	auto now = std::chrono::steady_clock::now();
+	for(auto &effect : model->GetEffects()) {
+		if(effect.start > now || effect.end <= now) continue;
+		auto atk_pos = effect.position;
+		if( isInRect(atk_pos, pos_offset, draw_size) ) {
+			auto &obj 	= model->GetTileAt(atk_pos);
+			setcolor(m_window, 4,0);
+			auto p = atk_pos - pos_offset + m_lt_draw_offset;
+			mvwprintw(m_window, p.y, p.x, "%c", model->GetCharMap()[(int)obj.type]);
+			unsetcolor(m_window, 4,0);
+			// flash stays until its end redraws frame
+			m_water_cells.erase(std::remove_if(m_water_cells.begin(), m_water_cells.end(), [&](const WaterCell& c) {
+				return c.pos.x == p.x && c.pos.y == p.y;
+			}), m_water_cells.end());
+		}
+	}
+	
+	if(model->IsMinimapShown()) {
+		renderMinimap();
+	}
+}
+
+// repaint only water cells with next animation phase, presentFrame refreshes them
+void View::animateWater() {
+	if(model->GetView() != ViewType::game || m_water_cells.empty()) return;
+	
+	m_water_phase ^= 1;
+	char water = model->GetCharMap()[(int)Tile::water];
+	for(auto &c : m_water_cells) {
+		setcolor(m_window, c.color.x, c.color.y);
+		mvwaddch(m_window, c.pos.y, c.pos.x, ((c.pos.x+c.pos.y+m_water_phase)&1) ? ' ' : water);
+		unsetcolor(m_window, c.color.x, c.color.y);
+	}
+	m_cells_dirty = true;
+}
+
+void View::Render() {
+	TRACE_SCOPE("Render");
+	{
+		PROFILE_SCOPE(model->GetProfiler(), Profiler::render);
+		renderView();
+	}
+	{
+		PROFILE_SCOPE(model->GetProfiler(), Profiler::refresh);
+		wrefresh(m_window);
+	}
+	m_frame_dirty = false;
+	m_cells_dirty = false;
+	m_frames.rendered++;
+}
+
+// draws current view into window, without refresh
+void View::renderView() {
 	switch(model->GetView()) {
 		
 		case ViewType::menu:
@@ -277,12 +579,13 @@ void View::Render() {
 			
 		case ViewType::game:
 			renderGame();
+			renderProfiler();
 			break;
 			
 		case ViewType::gamemenu:
 			renderGame();
+			renderProfiler();
 			renderMenu();
 			break;
 	}
-	wrefresh(m_window);
 }
@@ -1,6 +1,9 @@
 #pragma once
 #include "Model.hpp"
 #include "Signals.hpp"
+#include <glm/gtc/type_precision.hpp>
+#include <chrono>
+#include <vector>
 
 #ifdef NCURSES
 #include <ncurses.h>
@@ -10,6 +13,11 @@
 
 class View {
 public:
+	struct FrameStats {
+		uint64_t requested;
+		uint64_t rendered;
+	};
+	
 	View(Model* model, Signals* signals);
 	~View();
 	void Init();
@@ -17,16 +25,26 @@ public:
 	void Render();
 	void NewGame();
 	void Quit();
+	const FrameStats& GetFrameStats() const;
 
 private:
 
 	void drawRect(glm::ivec2 center, glm::ivec2 size);
 	void fillRect(glm::ivec2 center, glm::ivec2 size, char ch);
 	void putString(glm::ivec2 center, std::string str, int cursor=-1);
+	void renderView();
 	void renderMenu();
 	void renderGame();
 	void renderItemsMenu();
+	void renderTiles(glm::ivec2 pos_offset, glm::ivec2 draw_size);
+	void renderSummaries(int level, glm::ivec2 center, glm::ivec2 screen_pos, glm::ivec2 size);
+	void renderMinimap();
+	void renderProfiler();
 	void updateWindowSize();
+	void animateWater();
+	void dispatchKey(int c);
+	void requestFrame();
+	void presentFrame();
 	
 	Signals* signals;
 	Model* model;
@@ -36,4 +54,20 @@ private:
 	glm::ivec2 m_rb_draw_offset;
 	glm::ivec2 m_window_size;
 	int m_menu_position;
+	glm::ivec3 m_layout; // zoom level, minimap and profiler visibility of last rendered game frame
+	
+	// water cells drawn by last renderGame, animated by timer
+	struct WaterCell {
+		glm::i16vec2 pos; 	// on screen
+		glm::ivec2 	 color; // foreground and background from tile palette
+	};
+	std::vector<WaterCell> 					m_water_cells;
+	int 									m_water_phase;
+	std::chrono::steady_clock::time_point 	m_next_water_tick;
+	
+	// frame scheduling
+	bool 									m_frame_dirty;
+	bool 									m_cells_dirty; // only animated cells changed, refresh is enough
+	std::chrono::steady_clock::time_point 	m_next_frame;
+	FrameStats 								m_frames;
 };
@@ -0,0 +1,79 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads) : m_task(nullptr), m_count(0), m_next(0), m_busy(0), m_generation(0), m_quit(false) {
+	SetThreads(threads);
+}
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+void WorkerPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start.notify_all();
+	for(auto &t : m_threads) {
+		t.join();
+	}
+	m_threads.clear();
+	m_quit = false;
+}
+
+// new threads start from current generation, runs before them are not theirs; it is read
+// here and not in the thread, so a run started before the thread gets the lock is not missed
+void WorkerPool::SetThreads(int threads) {
+	stop();
+	for(int i = 1; i < std::max(1, threads); i++) {
+		m_threads.emplace_back(&WorkerPool::work, this, m_generation);
+	}
+}
+
+int WorkerPool::GetThreads() const {
+	return m_threads.size() + 1;
+}
+
+void WorkerPool::runTasks() {
+	for(int i = m_next++; i < m_count; i = m_next++) {
+		(*m_task)(i);
+	}
+}
+
+void WorkerPool::work(uint64_t generation) {
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&]{ return m_quit || m_generation != generation; });
+			if(m_quit) return;
+			generation = m_generation;
+		}
+		runTasks();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(--m_busy == 0) m_done.notify_one();
+		}
+	}
+}
+
+void WorkerPool::Run(int count, const std::function<void(int)>& task) {
+	if(m_threads.empty() || count <= 1) {
+		for(int i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_busy = m_threads.size();
+		m_generation++;
+	}
+	m_start.notify_all();
+	runTasks();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [&]{ return m_busy == 0; });
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Fixed set of threads running indexed tasks, calling thread takes part too.
+// With one thread tasks just run inline.
+class WorkerPool {
+public:
+	explicit WorkerPool(int threads = 1);
+	~WorkerPool();
+	void 	SetThreads(int threads);
+	int 	GetThreads() const;
+	
+	// runs task(i) for every i in [0, count), returns when all are done
+	void 	Run(int count, const std::function<void(int)>& task);
+
+private:
+	void 	stop();
+	void 	work(uint64_t generation);
+	void 	runTasks();
+	
+	std::vector<std::thread> 	m_threads;
+	std::mutex 					m_mutex;
+	std::condition_variable 	m_start;
+	std::condition_variable 	m_done;
+	const std::function<void(int)>* m_task;
+	int 						m_count;
+	std::atomic<int> 			m_next;
+	int 						m_busy;       // workers still in current run
+	uint64_t 					m_generation; // incremented for every run
+	bool 						m_quit;
+};
@@ -58,13 +58,15 @@ namespace OpenSimplexNoise
     {
       source[i] = i;
     }
-    seed = seed * 6364136223846793005l + 1442695040888963407l;
-    seed = seed * 6364136223846793005l + 1442695040888963407l;
-    seed = seed * 6364136223846793005l + 1442695040888963407l;
+    // LCG steps in unsigned arithmetic, signed overflow is undefined and got miscompiled with -flto
+    auto next = [](int64_t s) { return static_cast<int64_t>(static_cast<uint64_t>(s) * 6364136223846793005ul + 1442695040888963407ul); };
+    seed = next(seed);
+    seed = next(seed);
+    seed = next(seed);
     for (int i = 255; i >= 0; i--)
     {
-      seed = seed * 6364136223846793005l + 1442695040888963407l;
-      int r = static_cast<int>((seed + 31) % (i + 1));
+      seed = next(seed);
+      int r = static_cast<int>(static_cast<int64_t>(static_cast<uint64_t>(seed) + 31) % (i + 1));
       if (r < 0)
       {
         r += (i + 1);
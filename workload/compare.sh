@@ -0,0 +1,55 @@
+#!/bin/sh
+# Report comparing two builds on the workload: headless turns per second (best of 3 runs)
+# of replays and of soak with save/load, all benchmarks side by side, code sizes.
+# Fails without report if new build doesn't play recorded games the same way.
+# usage: workload/compare.sh base_bin_dir bin_dir   (from repository root)
+set -e
+base=$1
+new=$2
+
+# best turns per second of 3 runs, args are passed to headless
+best() {
+	for run in 1 2 3; do
+		"$@" | awk '/^turns per second:/ {print $4}'
+	done | sort -n | tail -n 1
+}
+
+row() {
+	name=$1
+	shift
+	a=$(best "$base/headless" "$@")
+	b=$(best "$new/headless" "$@")
+	awk -v n="$name" -v a="$a" -v b="$b" 'BEGIN {printf "%-20s %14d %14d %8.3f\n", n, a, b, b / a}'
+}
+
+for replay in workload/*.json; do
+	if ! "$new/headless" --replay "$replay" > /dev/null; then
+		echo "FAILED: $new/headless plays $replay differently, checkpoint hashes don't match" >&2
+		exit 1
+	fi
+done
+
+echo "base: $base"
+echo "new:  $new"
+echo "recorded games played the same: $(ls workload/*.json | wc -l)"
+echo
+printf "%-20s %14s %14s %8s\n" "headless" "base turns/s" "turns/s" "speedup"
+for replay in workload/*.json; do
+	row "$(basename "$replay" .json)" --replay "$replay"
+done
+row soak --soak --seed workload --turns 100000 --save-every 2000
+echo
+
+"$base/bench" --out "$new/bench_base.json" > /dev/null 2>&1
+"$new/bench" --out "$new/bench.json" > /dev/null 2>&1
+"$new/bench" --compare "$new/bench_base.json" "$new/bench.json"
+echo
+
+# text segment, debug info would hide the difference
+text() {
+	size "$1" | awk 'NR == 2 {print $1}'
+}
+printf "%-20s %14s %14s\n" "code" "base bytes" "bytes"
+for exe in game headless bench; do
+	printf "%-20s %14s %14s\n" "$exe" "$(text "$base/$exe")" "$(text "$new/$exe")"
+done
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Gameplay workload that trains the profile guided build: recorded games (exploring away
+# from start, fighting around it) replayed with their checkpoints checked, bot play with
+# deaths and save/load round trips, and rendering of game view at every zoom level.
+# usage: workload/run.sh [bin_dir]   (from repository root, binaries read config/)
+set -e
+bin=${1:-.}
+for replay in workload/*.json; do
+	echo "== $replay"
+	"$bin/headless" --replay "$replay"
+done
+echo "== soak"
+"$bin/headless" --soak --seed workload --turns 100000 --save-every 2000
+echo "== render"
+"$bin/bench" --filter render_game --min-time 0.1 --out /dev/null